@@ -26,11 +26,14 @@
 #include <sstream>
 #include <getopt.h>
 #include <memory>
+#include <algorithm>
 using namespace ALICE::HLT;
 using namespace AliceO2::AliceHLT;
 
 Component::Component()
   : mOutputBuffer()
+  , mMessageBufferSize(0)
+  , mTailroomBlockCnt(16)
   , mpSystem(NULL)
   , mProcessor(kEmptyHLTComponentHandle)
   , mFormatHandler()
@@ -95,6 +98,7 @@ int Component::init(int argc, char** argv)
         unsigned size = 0;
         std::stringstream(optarg) >> size;
         mOutputBuffer.resize(size);
+        mMessageBufferSize = size;
       } break;
       case 'm': {
         unsigned outputMode;
@@ -218,6 +222,16 @@ int Component::process(vector<MessageFormat::BufferDesc_t>& dataArray,
   eventTypeBlock.fSpecification = gkAliEventTypeData;
   inputBlocks.push_back(eventTypeBlock);
 
+  // with a buffer allocation callback, the component writes its output directly
+  // to a message buffer of the framework. Room is left in front of and after the
+  // output for the event header and the block descriptors, which are written in
+  // place when the messages are created
+  bool bInPlace = cbAllocate != nullptr && mFormatHandler.supportsInPlaceMessages();
+  unsigned headroom = mFormatHandler.getInPlaceHeadroom();
+  unsigned tailroom = mFormatHandler.getInPlaceTailroom(mTailroomBlockCnt);
+  AliHLTUInt8_t* pMessageBuffer = NULL;
+  AliHLTUInt8_t* pOutputBuffer = NULL;
+
   // process
   evtData.fBlockCnt = inputBlocks.size();
   int nofTrials = 2;
@@ -226,18 +240,38 @@ int Component::process(vector<MessageFormat::BufferDesc_t>& dataArray,
     unsigned long constBlockBase = 0;
     double inputBlockMultiplier = 0.;
     mpSystem->getOutputSize(mProcessor, &constEventBase, &constBlockBase, &inputBlockMultiplier);
-    outputBufferSize = constEventBase + nofInputBlocks * constBlockBase + totalInputSize * inputBlockMultiplier;
-    outputBufferSize+=sizeof(AliHLTComponentStatistics) + sizeof(AliHLTComponentTableEntry);
-    // take the full available buffer and increase if that
-    // is too little
-    mOutputBuffer.resize(mOutputBuffer.capacity());
-    if (mOutputBuffer.size() < outputBufferSize) {
-      mOutputBuffer.resize(outputBufferSize);
-    } else if (nofTrials < 2) {
-      // component did not update the output size
-      break;
+    unsigned requiredSize = constEventBase + nofInputBlocks * constBlockBase + totalInputSize * inputBlockMultiplier;
+    requiredSize+=sizeof(AliHLTComponentStatistics) + sizeof(AliHLTComponentTableEntry);
+    if (bInPlace) {
+      // same policy as for the internal buffer, the size of the largest
+      // buffer so far is requested again
+      if (mMessageBufferSize < requiredSize) {
+        mMessageBufferSize = requiredSize;
+      } else if (nofTrials < 2) {
+        // component did not update the output size
+        break;
+      }
+      outputBufferSize = mMessageBufferSize;
+      pMessageBuffer = *(*cbAllocate)(headroom + outputBufferSize + tailroom);
+      if (pMessageBuffer == NULL) {
+        cerr << "error: can not allocate output buffer of size " << headroom + outputBufferSize + tailroom << endl;
+        return -ENOMEM;
+      }
+      pOutputBuffer = pMessageBuffer + headroom;
+    } else {
+      // take the full available buffer and increase if that
+      // is too little
+      mOutputBuffer.resize(mOutputBuffer.capacity());
+      if (mOutputBuffer.size() < requiredSize) {
+        mOutputBuffer.resize(requiredSize);
+      } else if (nofTrials < 2) {
+        // component did not update the output size
+        break;
+      }
+      outputBufferSize = mOutputBuffer.size();
+      pOutputBuffer = &mOutputBuffer[0];
     }
-    outputBufferSize = mOutputBuffer.size();
+    unsigned outputBufferCapacity = outputBufferSize;
     outputBlockCnt = 0;
     // TODO: check if that is working with the corresponding allocation method of the
     // component environment
@@ -247,26 +281,29 @@ int Component::process(vector<MessageFormat::BufferDesc_t>& dataArray,
     pEventDoneData = NULL;
 
     iResult = mpSystem->processEvent(mProcessor, &evtData, &inputBlocks[0], &trigData,
-                                     &mOutputBuffer[0], &outputBufferSize,
+                                     pOutputBuffer, &outputBufferSize,
                                      &outputBlockCnt, &pOutputBlocks,
                                      &pEventDoneData);
-    if (outputBufferSize > 0) {
-      if (outputBufferSize > mOutputBuffer.size()) {
-        cerr << "fatal error: component writing beyond buffer capacity" << endl;
-        return -EFAULT;
-      } else if (outputBufferSize < mOutputBuffer.size()) {
-        mOutputBuffer.resize(outputBufferSize);
+    if (outputBufferSize > outputBufferCapacity) {
+      cerr << "fatal error: component writing beyond buffer capacity" << endl;
+      return -EFAULT;
+    }
+    if (!bInPlace) {
+      if (outputBufferSize > 0) {
+        if (outputBufferSize < mOutputBuffer.size()) {
+          mOutputBuffer.resize(outputBufferSize);
+        }
+      } else {
+        mOutputBuffer.clear();
       }
-    } else {
-      mOutputBuffer.clear();
     }
 
   } while (iResult == ENOSPC && --nofTrials > 0);
 
   // prepare output
   if (outputBlockCnt >= 0) {
-    AliHLTUInt8_t* pOutputBufferStart = &mOutputBuffer[0];
-    AliHLTUInt8_t* pOutputBufferEnd = pOutputBufferStart + mOutputBuffer.size();
+    AliHLTUInt8_t* pOutputBufferStart = pOutputBuffer;
+    AliHLTUInt8_t* pOutputBufferEnd = pOutputBufferStart + outputBufferSize;
     // consistency check for data blocks
     // 1) all specified data must be either inside the output buffer given
     //    to the component or in one of the input buffers
@@ -290,7 +327,7 @@ int Component::process(vector<MessageFormat::BufferDesc_t>& dataArray,
 
       // calculate the data reference
       AliHLTUInt8_t* pStart =
-        pOutputBlock->fPtr != NULL ? reinterpret_cast<AliHLTUInt8_t*>(pOutputBlock->fPtr) : &mOutputBuffer[0];
+        pOutputBlock->fPtr != NULL ? reinterpret_cast<AliHLTUInt8_t*>(pOutputBlock->fPtr) : pOutputBuffer;
       pStart += pOutputBlock->fOffset;
       AliHLTUInt8_t* pEnd = pStart + pOutputBlock->fSize;
       pOutputBlock->fPtr = pStart;
@@ -322,12 +359,27 @@ int Component::process(vector<MessageFormat::BufferDesc_t>& dataArray,
     }
     evtData.fBlockCnt=validBlocks;
 
-    // create the messages
-    // TODO: for now there is an extra copy of the data, but it should be
-    // handled in place
-    vector<MessageFormat::BufferDesc_t> outputMessages =
-      mFormatHandler.createMessages(pOutputBlocks, validBlocks, totalPayloadSize, evtData, cbAllocate);
-    dataArray.insert(dataArray.end(), outputMessages.begin(), outputMessages.end());
+    // create the messages, in place in the message buffer if possible, a copy
+    // is needed for the internal buffer, HOMER format, and forwarded blocks
+    int inPlaceResult = -EINVAL;
+    if (bInPlace) {
+      inPlaceResult = mFormatHandler.createMessagesInPlace(pOutputBlocks, validBlocks, evtData, pMessageBuffer,
+                                                           headroom + mMessageBufferSize + tailroom, dataArray);
+      if (inPlaceResult == -ENOSPC) {
+        cerr << "warning: no room for the descriptors of " << validBlocks << " output blocks in the message buffer"
+             << " (tailroom for " << mTailroomBlockCnt << "), copying the output" << endl;
+      }
+    }
+    // same policy as for the buffer size, the tailroom grows to the largest
+    // number of blocks so far
+    if (validBlocks > mTailroomBlockCnt) {
+      mTailroomBlockCnt = validBlocks;
+    }
+    if (inPlaceResult < 0) {
+      vector<MessageFormat::BufferDesc_t> outputMessages =
+        mFormatHandler.createMessages(pOutputBlocks, validBlocks, totalPayloadSize, evtData, cbAllocate);
+      dataArray.insert(dataArray.end(), outputMessages.begin(), outputMessages.end());
+    }
   }
 
   // cleanup
@@ -89,6 +89,12 @@ private:
 
   /// output buffer to receive the data produced by component
   vector<AliHLTUInt8_t> mOutputBuffer;
+  /// size of the component output in message buffers allocated through the
+  /// callback, grows with the requirements like the internal output buffer
+  unsigned mMessageBufferSize;
+  /// number of block descriptors the tailroom of message buffers is sized for,
+  /// grows to the largest number of output blocks of the component so far
+  unsigned mTailroomBlockCnt;
 
   /// instance of the system interface
   SystemInterface* mpSystem;
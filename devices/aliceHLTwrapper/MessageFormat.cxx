@@ -336,6 +336,84 @@ vector<MessageFormat::BufferDesc_t> MessageFormat::createMessages(const AliHLTCo
   return mMessages;
 }
 
+int MessageFormat::createMessagesInPlace(const AliHLTComponentBlockData* blocks, unsigned count,
+                                         const AliHLTComponentEventData& evtData,
+                                         AliHLTUInt8_t* buffer, unsigned size,
+                                         vector<BufferDesc_t>& messages)
+{
+  // create messages in place from blocks in a buffer which starts with the
+  // headroom, followed by the component output and the tailroom
+  if (!supportsInPlaceMessages()) return -EINVAL;
+  if (buffer == NULL || size < getInPlaceHeadroom()) return -ENOSPC;
+
+  // the target layout is the same as for createMessages: event header followed
+  // by the sequence of block descriptor and payload, starting at the beginning
+  // of the buffer. The payload of the first block stays in place if it starts
+  // at the beginning of the component output
+  AliHLTUInt8_t* pOutputStart = buffer + getInPlaceHeadroom();
+  AliHLTUInt8_t* pBufferEnd = buffer + size;
+  AliHLTUInt8_t* pSourceEnd = pOutputStart;
+  vector<AliHLTUInt8_t*> targets(count, NULL);
+  unsigned position = sizeof(evtData);
+  for (unsigned bi = 0; bi < count; bi++) {
+    position += sizeof(AliHLTComponentBlockData);
+    targets[bi] = buffer + position;
+    position += blocks[bi].fSize;
+    if (blocks[bi].fSize == 0) continue;
+    AliHLTUInt8_t* pSource = reinterpret_cast<AliHLTUInt8_t*>(blocks[bi].fPtr) + blocks[bi].fOffset;
+    if (pSource < pSourceEnd || pSource + blocks[bi].fSize > pBufferEnd) {
+      // forwarded block, overlapping blocks, or blocks not in ascending order
+      return -EINVAL;
+    }
+    pSourceEnd = pSource + blocks[bi].fSize;
+  }
+  if (position > size) {
+    return -ENOSPC;
+  }
+
+  // payloads moving towards the beginning of the buffer are moved in ascending
+  // order, payloads moving towards the end in descending order, this way none
+  // of them overwrites a payload which has not been moved yet
+  for (unsigned bi = 0; bi < count; bi++) {
+    AliHLTUInt8_t* pSource = reinterpret_cast<AliHLTUInt8_t*>(blocks[bi].fPtr) + blocks[bi].fOffset;
+    if (blocks[bi].fSize > 0 && targets[bi] < pSource) {
+      memmove(targets[bi], pSource, blocks[bi].fSize);
+    }
+  }
+  for (unsigned bi = count; bi-- > 0;) {
+    AliHLTUInt8_t* pSource = reinterpret_cast<AliHLTUInt8_t*>(blocks[bi].fPtr) + blocks[bi].fOffset;
+    if (blocks[bi].fSize > 0 && targets[bi] > pSource) {
+      memmove(targets[bi], pSource, blocks[bi].fSize);
+    }
+  }
+
+  // event header and block descriptors are written after all payloads are in
+  // their final position, they might overlap with the original positions
+  memcpy(buffer, &evtData, sizeof(evtData));
+  if (mOutputMode == kOutputModeMultiPart && evtData.fBlockCnt>1) {
+    // one block per part, @see createMessages
+    reinterpret_cast<AliHLTComponentEventData*>(buffer)->fBlockCnt=1;
+  }
+  for (unsigned bi = 0; bi < count; bi++) {
+    auto* bdTarget = reinterpret_cast<AliHLTComponentBlockData*>(targets[bi] - sizeof(AliHLTComponentBlockData));
+    memcpy(bdTarget, &blocks[bi], sizeof(AliHLTComponentBlockData));
+    bdTarget->fOffset = 0;
+    bdTarget->fPtr = NULL;
+  }
+
+  if (mOutputMode == kOutputModeSequence || count == 0) {
+    // one single descriptor for all concatenated blocks
+    messages.push_back(MessageFormat::BufferDesc_t(buffer, position));
+  } else {
+    // one descriptor per block, the first one includes the event header
+    for (unsigned bi = 0; bi < count; bi++) {
+      AliHLTUInt8_t* pStart = bi == 0 ? buffer : targets[bi] - sizeof(AliHLTComponentBlockData);
+      messages.push_back(MessageFormat::BufferDesc_t(pStart, targets[bi] + blocks[bi].fSize - pStart));
+    }
+  }
+  return count;
+}
+
 AliHLTHOMERWriter* MessageFormat::createHOMERFormat(const AliHLTComponentBlockData* pOutputBlocks,
                                                     AliHLTUInt32_t outputBlockCnt) const
 {
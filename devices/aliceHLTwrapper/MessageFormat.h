@@ -102,6 +102,40 @@ public:
                                       unsigned totalPayloadSize, const AliHLTComponentEventData& evtData,
                                       boost::signals2::signal<unsigned char* (unsigned int)> *cbAllocate=nullptr);
 
+  // check if the output mode supports assembling the messages in place,
+  // i.e. in the buffer the component has written its output to
+  bool supportsInPlaceMessages() const
+  {
+    return mOutputMode == kOutputModeMultiPart || mOutputMode == kOutputModeSequence;
+  }
+
+  // space to be reserved in front of the component output for assembling
+  // messages in place: event header and the descriptor of the first block
+  unsigned getInPlaceHeadroom() const
+  {
+    return sizeof(AliHLTComponentEventData) + sizeof(AliHLTComponentBlockData);
+  }
+
+  // space to be reserved after the component output for assembling messages
+  // in place, room for the descriptors of the given number of further blocks
+  unsigned getInPlaceTailroom(unsigned nofBlocks) const
+  {
+    return nofBlocks * sizeof(AliHLTComponentBlockData);
+  }
+
+  // create messages in place from blocks in a buffer which starts with the
+  // headroom, followed by the component output and the tailroom
+  // block descriptors are written directly in front of the payloads, a payload
+  // is only moved within the buffer if the component did not leave room for
+  // its descriptor; the descriptors of the messages are appended to the list
+  // the buffer is left untouched and -EINVAL is returned if the blocks are not
+  // all in the component output, in ascending order, and -ENOSPC if the
+  // descriptors do not fit, the messages have to be created by copy then
+  int createMessagesInPlace(const AliHLTComponentBlockData* blocks, unsigned count,
+                            const AliHLTComponentEventData& evtData,
+                            AliHLTUInt8_t* buffer, unsigned size,
+                            vector<BufferDesc_t>& messages);
+
   // read a sequence of blocks consisting of AliHLTComponentBlockData followed by payload
   // from a buffer
   int readBlockSequence(AliHLTUInt8_t* buffer, unsigned size, vector<AliHLTComponentBlockData>& descriptorList) const;
@@ -48,6 +48,8 @@ WrapperDevice::WrapperDevice(int argc, char** argv, int verbosity)
   : mComponent(NULL)
   , mArgv()
   , mMessages()
+  , mMessageBuffers()
+  , mFreeMessageBuffers()
   , mPollingPeriod(10)
   , mSkipProcessing(0)
   , mLastCalcTime(-1)
@@ -64,6 +66,8 @@ WrapperDevice::WrapperDevice(int argc, char** argv, int verbosity)
 
 WrapperDevice::~WrapperDevice()
 {
+  for (auto buffer : mFreeMessageBuffers) releaseMessageBuffer(buffer->mData, buffer);
+  mFreeMessageBuffers.clear();
 }
 
 void WrapperDevice::Init()
@@ -223,13 +227,20 @@ void WrapperDevice::Run()
         }
         for (auto opayload : dataArray) {
           FairMQMessage* omsg=nullptr;
-          // loop over pre-allocated messages
-          for (auto premsg = begin(mMessages); premsg != end(mMessages); premsg++) {
-            if ((*premsg)->GetData() == opayload.mP &&
-                (*premsg)->GetSize() == opayload.mSize) {
-              omsg=*premsg;
-              if (mVerbosity > 2) {
-                LOG(DEBUG) << "using pre-allocated message of size " << opayload.mSize;
+          // loop over pre-allocated buffers, the message references the payload
+          // in the buffer
+          for (auto buffer : mMessageBuffers) {
+            if (opayload.mP >= buffer->mData &&
+                opayload.mP + opayload.mSize <= buffer->mData + buffer->mSize) {
+              unique_ptr<FairMQMessage> msg(fTransportFactory->CreateMessage());
+              if (msg.get()) {
+                buffer->mRefCount++;
+                msg->Rebuild(opayload.mP, opayload.mSize, &WrapperDevice::releaseMessageBuffer, buffer);
+                omsg=msg.release();
+                mMessages.push_back(omsg);
+                if (mVerbosity > 2) {
+                  LOG(DEBUG) << "using pre-allocated buffer for message of size " << opayload.mSize;
+                }
               }
               break;
             }
@@ -285,6 +296,15 @@ void WrapperDevice::Run()
         for (auto sendmsg : mMessages) delete sendmsg;
         mMessages.clear();
       }
+      // the device keeps its reference to reuse the buffers, the oldest ones
+      // beyond the limit are released and freed as soon as the transport is
+      // done with the messages
+      mFreeMessageBuffers.insert(mFreeMessageBuffers.end(), mMessageBuffers.begin(), mMessageBuffers.end());
+      mMessageBuffers.clear();
+      while (mFreeMessageBuffers.size() > kMaxFreeMessageBuffers) {
+        releaseMessageBuffer(mFreeMessageBuffers.front()->mData, mFreeMessageBuffers.front());
+        mFreeMessageBuffers.erase(mFreeMessageBuffers.begin());
+      }
     }
 
     // cleanup
@@ -354,17 +374,42 @@ int WrapperDevice::GetProperty(const int key, const int default_)
 
 unsigned char* WrapperDevice::createMessageBuffer(unsigned size)
 {
-  /// create a new message with data buffer of specified size
-  unique_ptr<FairMQMessage> msg(fTransportFactory->CreateMessage());
-  if (msg.get()==nullptr) return nullptr;
-  msg->Rebuild(size);
-  if (msg->GetSize() < size) {
-    return nullptr;
+  /// get a buffer of at least the specified size for output messages
+
+  // a buffer with only the reference of the device left is not used by any
+  // message anymore
+  for (auto it = mFreeMessageBuffers.begin(); it != mFreeMessageBuffers.end(); it++) {
+    MessageBuffer* buffer = *it;
+    if (buffer->mRefCount == 1 && buffer->mSize >= size) {
+      mFreeMessageBuffers.erase(it);
+      mMessageBuffers.push_back(buffer);
+      if (mVerbosity > 2) {
+        LOG(DEBUG) << "reusing message buffer of size " << buffer->mSize << " for " << size;
+      }
+      return buffer->mData;
+    }
   }
 
+  unique_ptr<MessageBuffer> buffer(new MessageBuffer);
+  buffer->mData = new (std::nothrow) unsigned char[size];
+  if (buffer->mData == nullptr) return nullptr;
+  buffer->mSize = size;
+  // the reference of the device, released after the messages have been sent
+  buffer->mRefCount = 1;
+
   if (mVerbosity > 2) {
-    LOG(DEBUG) << "allocating message of size " << size;
+    LOG(DEBUG) << "allocating message buffer of size " << size;
+  }
+  mMessageBuffers.push_back(buffer.release());
+  return mMessageBuffers.back()->mData;
+}
+
+void WrapperDevice::releaseMessageBuffer(void* /*data*/, void* hint)
+{
+  /// release a reference to a MessageBuffer (hint), free function of the messages
+  MessageBuffer* buffer = reinterpret_cast<MessageBuffer*>(hint);
+  if (--buffer->mRefCount == 0) {
+    delete[] buffer->mData;
+    delete buffer;
   }
-  mMessages.push_back(msg.release());
-  return reinterpret_cast<AliHLTUInt8_t*>(mMessages.back()->GetData());
 }
@@ -21,6 +21,7 @@
 
 #include "FairMQDevice.h"
 #include <vector>
+#include <atomic>
 
 class FairMQMessage;
 
@@ -78,12 +79,29 @@ private:
   // assignment operator prohibited
   WrapperDevice& operator=(const WrapperDevice&);
 
-  /// create a new message with data buffer of specified size
+  /// buffer for the component output, allocated on request of the component
+  /// the output messages reference parts of it without copy, the buffer is
+  /// freed with the last reference
+  struct MessageBuffer {
+    std::atomic<int> mRefCount;
+    unsigned mSize;
+    unsigned char* mData;
+  };
+
+  /// maximum number of buffers kept for reuse in the following events
+  static const unsigned kMaxFreeMessageBuffers = 8;
+
+  /// get a buffer of at least the specified size for output messages, a
+  /// buffer of a previous event is reused if the transport has released it
   unsigned char* createMessageBuffer(unsigned size);
+  /// release a reference to a MessageBuffer (hint), free function of the messages
+  static void releaseMessageBuffer(void* data, void* hint);
 
   Component* mComponent;     // component instance
   std::vector<char*> mArgv;       // array of arguments for the component
   std::vector<FairMQMessage*> mMessages; // array of output messages
+  std::vector<MessageBuffer*> mMessageBuffers; // output buffers allocated for the current event
+  std::vector<MessageBuffer*> mFreeMessageBuffers; // buffers of previous events, still referenced by the device
 
   int mPollingPeriod;        // period of polling on input sockets in ms
   int mSkipProcessing;       // skip component processing
@@ -16,6 +16,7 @@
 //  @brief  FairRoot/ALFA device running ALICE HLT code
 
 #include "WrapperDevice.h"
+#include "DevicePlacement.h"
 #include <iostream>
 #include <getopt.h>
 #include <memory>
@@ -158,6 +159,10 @@ int main(int argc, char** argv)
   int skipProcessing = 0;
   bool bUseDDS = false;
   int timeout=-1;
+  std::string deviceCPUs;
+  std::string ioCPUs;
+  int numaNode = -1;
+  std::string numaNIC;
 
   static struct option programOptions[] = {
     { "input",       required_argument, 0, 'i' }, // input socket
@@ -169,6 +174,10 @@ int main(int argc, char** argv)
     { "dry-run",     no_argument      , 0, 'n' }, // skip the component processing
     { "dds",         no_argument      , 0, 'd' }, // run in dds mode
     { "timeout",     required_argument, 0, 't' }, // polling period of the device in ms
+    { "device-cpus", required_argument, 0, 'D' }, // CPUs for the device threads
+    { "io-cpus",     required_argument, 0, 'I' }, // CPUs for the transport I/O threads
+    { "numa-node",   required_argument, 0, 'N' }, // NUMA node for the message buffers
+    { "numa-nic",    required_argument, 0, 'M' }, // network interface whose NUMA node gets the message buffers
     { 0, 0, 0, 0 }
   };
 
@@ -253,6 +262,18 @@ int main(int argc, char** argv)
       case 'n':
         skipProcessing = 1;
         break;
+      case 'D':
+        deviceCPUs = optarg;
+        break;
+      case 'I':
+        ioCPUs = optarg;
+        break;
+      case 'N':
+        std::stringstream(optarg) >> numaNode;
+        break;
+      case 'M':
+        numaNIC = optarg;
+        break;
       case 'd':
         bUseDDS = true;
         break;
@@ -315,6 +336,10 @@ int main(int argc, char** argv)
     cout << "        --loginterval,-l             period_in_ms" << endl;
     cout << "        --verbosity,-v 0xhexval      verbosity level" << endl;
     cout << "        --dry-run,-n                 skip the component processing" << endl;
+    cout << "        --device-cpus,-D cpulist     pin the device threads, e.g. 0-7,16-23" << endl;
+    cout << "        --io-cpus,-I cpulist         pin the transport I/O threads" << endl;
+    cout << "        --numa-node,-N node          allocate the message buffers on this NUMA node" << endl;
+    cout << "        --numa-nic,-M interface      allocate the message buffers on the NUMA node of the interface" << endl;
     cout << "        Multiple slots can be defined by --input/--output options" << endl;
     cout << "        HLT component arguments at the end of the list" << endl;
     cout << "        --library,-l     componentLibrary" << endl;
@@ -325,6 +350,16 @@ int main(int argc, char** argv)
     return 0;
   }
 
+  // threads inherit the placement of this thread: the I/O threads are started in INIT_DEVICE,
+  // the device thread in RUN, the memory policy applies to all buffers allocated from now on
+  AliceO2::Devices::DevicePlacement placement;
+  if (!placement.Configure(deviceCPUs, ioCPUs, numaNode, numaNIC)) {
+    return -EINVAL;
+  }
+  placement.SetMemoryPolicy();
+  placement.PinIoThreads();
+  placement.Report();
+
   FairMQTransportFactory* transportFactory = NULL;
   if (strcmp(factoryType, "nanomsg") == 0) {
 #ifdef NANOMSG
@@ -448,6 +483,7 @@ int main(int argc, char** argv)
     device.ChangeState("INIT_TASK");
     device.WaitForEndOfState("INIT_TASK");
 
+    placement.PinDeviceThreads();
     device.ChangeState("RUN");
 
     auto refTime = boost::chrono::system_clock::now();
@@ -0,0 +1,253 @@
+/**
+ * DevicePlacement.cxx
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#include <fstream>
+#include <sstream>
+#include <algorithm> // sort, unique
+#include <cstdlib> // strtol
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h> // syscall
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <cerrno>
+#include <cstring> // strerror
+#endif
+
+#include "FairMQLogger.h"
+
+#include "DevicePlacement.h"
+
+using namespace std;
+using namespace AliceO2::Devices;
+
+DevicePlacement::DevicePlacement()
+  : fDeviceCPUs()
+  , fIoCPUs()
+  , fNumaNode(-1)
+  , fNumaNIC()
+  , fMemoryPolicySet(false)
+{
+}
+
+bool DevicePlacement::ParseCPUList(const string& list, vector<int>& cpus)
+{
+  cpus.clear();
+
+  stringstream ranges(list);
+  string range;
+  while (getline(ranges, range, ',')) {
+    char* end = nullptr;
+    long first = strtol(range.c_str(), &end, 10);
+    long last = first;
+    if (end == range.c_str() || first < 0) {
+      return false;
+    }
+    if (*end == '-') {
+      const char* begin = end + 1;
+      last = strtol(begin, &end, 10);
+      if (end == begin || last < first) {
+        return false;
+      }
+    }
+    if (*end != '\0' && *end != '\n') {
+      return false;
+    }
+    for (long cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  sort(cpus.begin(), cpus.end());
+  cpus.erase(unique(cpus.begin(), cpus.end()), cpus.end());
+
+  return !cpus.empty();
+}
+
+int DevicePlacement::NodeOfNIC(const string& nic)
+{
+  // -1 for devices without NUMA affinity (or on single-node machines).
+  ifstream file(("/sys/class/net/" + nic + "/device/numa_node").c_str());
+  int node = -1;
+  if (!(file >> node)) {
+    return -1;
+  }
+  return node;
+}
+
+int DevicePlacement::NodeOfCPU(int cpu)
+{
+  // the node of a CPU appears as a nodeN entry in its sysfs directory, the node lists are easier to read.
+  for (int node = 0; node < 1024; ++node) {
+    ifstream file(("/sys/devices/system/node/node" + to_string(node) + "/cpulist").c_str());
+    if (!file) {
+      return -1;
+    }
+    string list;
+    vector<int> cpus;
+    if (getline(file, list) && ParseCPUList(list, cpus) && binary_search(cpus.begin(), cpus.end(), cpu)) {
+      return node;
+    }
+  }
+  return -1;
+}
+
+bool DevicePlacement::Configure(const string& deviceCPUs, const string& ioCPUs, int numaNode, const string& numaNIC)
+{
+  fDeviceCPUs.clear();
+  fIoCPUs.clear();
+  fNumaNode = -1;
+  fNumaNIC.clear();
+
+  if (!deviceCPUs.empty() && !ParseCPUList(deviceCPUs, fDeviceCPUs)) {
+    LOG(ERROR) << "Invalid device CPU list \"" << deviceCPUs << "\"";
+    return false;
+  }
+  if (!ioCPUs.empty() && !ParseCPUList(ioCPUs, fIoCPUs)) {
+    LOG(ERROR) << "Invalid I/O CPU list \"" << ioCPUs << "\"";
+    return false;
+  }
+
+  if (numaNode >= 0) {
+    fNumaNode = numaNode;
+  } else if (!numaNIC.empty()) {
+    fNumaNode = NodeOfNIC(numaNIC);
+    if (fNumaNode < 0) {
+      LOG(ERROR) << "Could not determine the NUMA node of network interface " << numaNIC;
+      return false;
+    }
+    fNumaNIC = numaNIC;
+  }
+
+  return true;
+}
+
+bool DevicePlacement::SetMemoryPolicy()
+{
+  if (fNumaNode < 0) {
+    return true;
+  }
+
+#ifdef __linux__
+  // preferred instead of bound: when the node runs out of memory, allocations fall back to the other nodes.
+  vector<unsigned long> mask(fNumaNode / (8 * sizeof(unsigned long)) + 1, 0);
+  mask[fNumaNode / (8 * sizeof(unsigned long))] = 1UL << (fNumaNode % (8 * sizeof(unsigned long)));
+  if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask.data(), mask.size() * 8 * sizeof(unsigned long) + 1) != 0) {
+    LOG(ERROR) << "Could not set the preferred NUMA node " << fNumaNode << ": " << strerror(errno);
+    return false;
+  }
+  fMemoryPolicySet = true;
+  return true;
+#else
+  LOG(WARN) << "NUMA memory placement is not supported on this platform";
+  return false;
+#endif
+}
+
+bool DevicePlacement::Pin(const vector<int>& cpus, const char* what)
+{
+  if (cpus.empty()) {
+    return true;
+  }
+
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu >= CPU_SETSIZE) {
+      LOG(ERROR) << "CPU " << cpu << " out of range for the " << what << " threads";
+      return false;
+    }
+    CPU_SET(cpu, &set);
+  }
+
+  int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (result != 0) {
+    LOG(ERROR) << "Could not pin the " << what << " threads to CPUs " << Describe(cpus) << ": " << strerror(result);
+    return false;
+  }
+  return true;
+#else
+  LOG(WARN) << "CPU affinity is not supported on this platform, the " << what << " threads are not pinned";
+  return false;
+#endif
+}
+
+bool DevicePlacement::PinIoThreads()
+{
+  return Pin(fIoCPUs, "I/O");
+}
+
+bool DevicePlacement::PinDeviceThreads()
+{
+  return Pin(fDeviceCPUs, "device");
+}
+
+string DevicePlacement::Describe(const vector<int>& cpus)
+{
+  stringstream out;
+
+  for (size_t i = 0; i < cpus.size(); ) {
+    size_t j = i;
+    while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+      ++j;
+    }
+    out << (i > 0 ? "," : "") << cpus[i];
+    if (j > i) {
+      out << "-" << cpus[j];
+    }
+    i = j + 1;
+  }
+
+  // nodes in the order of the CPUs, each once.
+  vector<int> nodes;
+  for (int cpu : cpus) {
+    int node = NodeOfCPU(cpu);
+    if (find(nodes.begin(), nodes.end(), node) == nodes.end()) {
+      nodes.push_back(node);
+    }
+  }
+
+  out << " (NUMA node" << (nodes.size() > 1 ? "s " : " ");
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    out << (i > 0 ? "," : "");
+    if (nodes[i] < 0) {
+      out << "unknown";
+    } else {
+      out << nodes[i];
+    }
+  }
+  out << ")";
+
+  return out.str();
+}
+
+void DevicePlacement::Report() const
+{
+  LOG(INFO) << "Device threads: " << (fDeviceCPUs.empty() ? "not pinned" : "CPUs " + Describe(fDeviceCPUs));
+  LOG(INFO) << "I/O threads: " << (fIoCPUs.empty() ? "not pinned" : "CPUs " + Describe(fIoCPUs));
+
+  if (fMemoryPolicySet) {
+    LOG(INFO) << "Memory: preferred NUMA node " << fNumaNode << (fNumaNIC.empty() ? "" : " (of " + fNumaNIC + ")");
+  } else {
+    LOG(INFO) << "Memory: default NUMA policy";
+  }
+
+  // memory far from the threads that use it costs bandwidth on the inter-socket link.
+  if (fMemoryPolicySet) {
+    for (const vector<int>* cpus : { &fDeviceCPUs, &fIoCPUs }) {
+      for (int cpu : *cpus) {
+        int node = NodeOfCPU(cpu);
+        if (node >= 0 && node != fNumaNode) {
+          LOG(WARN) << "CPU " << cpu << " is on NUMA node " << node << ", not on the memory node " << fNumaNode;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,81 @@
+/**
+ * DevicePlacement.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef ALICEO2_DEVICES_DEVICEPLACEMENT_H_
+#define ALICEO2_DEVICES_DEVICEPLACEMENT_H_
+
+#include <string>
+#include <vector>
+
+namespace AliceO2 {
+namespace Devices {
+
+/// CPU and memory placement of the threads of a device process, set up by the run executables
+///
+/// Threads inherit the CPU affinity and the NUMA memory policy of the thread that creates them. The transport
+/// starts its I/O threads while the device is initialized, and the device thread (with the threads it starts)
+/// when the device is set to running, both from the main thread. The run executables therefore call PinIoThreads()
+/// before INIT_DEVICE and PinDeviceThreads() before RUN. The memory policy applies from SetMemoryPolicy() on,
+/// which is called before the device creates any buffers: message buffers are then allocated on the preferred
+/// NUMA node, typically the one of the NIC, as long as it has free memory. Linux only, elsewhere it only reports.
+
+class DevicePlacement
+{
+  public:
+    /// Default constructor, no placement
+    DevicePlacement();
+
+    /// Sets the placement
+    /// @param deviceCPUs   CPUs for the device threads, e.g. "0-3,8" (empty - not pinned)
+    /// @param ioCPUs       CPUs for the transport I/O threads (empty - not pinned)
+    /// @param numaNode     Preferred NUMA node for the memory (-1 - the node of the NIC, if any)
+    /// @param numaNIC      Network interface whose NUMA node is preferred if numaNode is -1 (empty - none)
+    /// @return             false if a CPU list is invalid or the node of the NIC cannot be determined
+    bool Configure(const std::string& deviceCPUs, const std::string& ioCPUs, int numaNode, const std::string& numaNIC);
+
+    /// Sets the memory policy of the calling thread (inherited by the threads it starts)
+    /// @return false if the policy could not be set
+    bool SetMemoryPolicy();
+    /// Pins the calling thread to the I/O CPUs, to be called before the transport starts its threads
+    /// @return false if the affinity could not be set
+    bool PinIoThreads();
+    /// Pins the calling thread to the device CPUs, to be called before the device thread is started
+    /// @return false if the affinity could not be set
+    bool PinDeviceThreads();
+
+    /// Logs the placement in effect, with the NUMA nodes of the CPUs
+    void Report() const;
+
+    /// Parses a CPU list in the format of /sys (e.g. "0-3,8,10-11")
+    /// @param list Comma-separated CPU numbers and ranges
+    /// @param cpus Parsed CPU numbers, ascending
+    /// @return     false if the list is invalid
+    static bool ParseCPUList(const std::string& list, std::vector<int>& cpus);
+    /// NUMA node of a network interface
+    /// @return -1 if unknown
+    static int NodeOfNIC(const std::string& nic);
+    /// NUMA node of a CPU
+    /// @return -1 if unknown
+    static int NodeOfCPU(int cpu);
+
+  private:
+    /// Pins the calling thread to the given CPUs
+    bool Pin(const std::vector<int>& cpus, const char* what);
+    /// Formats CPU numbers as a list with ranges, with their NUMA nodes
+    static std::string Describe(const std::vector<int>& cpus);
+
+    std::vector<int> fDeviceCPUs; ///< CPUs for the device threads (empty - not pinned)
+    std::vector<int> fIoCPUs; ///< CPUs for the transport I/O threads (empty - not pinned)
+    int fNumaNode; ///< Preferred NUMA node for the memory (-1 - none)
+    std::string fNumaNIC; ///< Network interface the NUMA node was taken from (empty - given directly)
+    bool fMemoryPolicySet; ///< true if the memory policy is in effect
+};
+
+} // namespace Devices
+} // namespace AliceO2
+
+#endif
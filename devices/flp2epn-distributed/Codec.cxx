@@ -0,0 +1,370 @@
+/**
+ * Codec.cxx
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#include <cstring> // memcpy, memset
+#include <vector>
+
+#include <zlib.h>
+
+#include "Codec.h"
+
+using namespace std;
+using namespace AliceO2::Devices;
+
+namespace
+{
+const int kMinMatch = 4; ///< Shortest match that is encoded
+const int kLastLiterals = 5; ///< The last bytes of a block are always literals
+const int kMatchSearchLimit = 12; ///< No match starts within the last bytes of a block
+const int kHashLog = 14; ///< Size of the match finder hash table (2^kHashLog entries)
+const size_t kMaxOffset = 65535; ///< Maximum distance of a match
+
+inline uint32_t read32(const uint8_t* p)
+{
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint32_t hash32(uint32_t sequence)
+{
+  return (sequence * 2654435761U) >> (32 - kHashLog);
+}
+
+/// Writes the remainder of a length that did not fit into its 4 bits of the token
+inline uint8_t* writeLength(uint8_t* op, size_t length)
+{
+  while (length >= 255) {
+    *op++ = 255;
+    length -= 255;
+  }
+  *op++ = static_cast<uint8_t>(length);
+  return op;
+}
+
+/// Reads the remainder of a length, false if the input ends before it
+inline bool readLength(const uint8_t*& ip, const uint8_t* iend, size_t& length)
+{
+  uint8_t b;
+  do {
+    if (ip >= iend) {
+      return false;
+    }
+    b = *ip++;
+    length += b;
+  } while (b == 255);
+  return true;
+}
+
+/// Writes one sequence: literals followed by a match (matchLength 0 for the last sequence, which has no match)
+inline uint8_t* writeSequence(uint8_t* op, const uint8_t* literals, size_t numLiterals, size_t offset, size_t matchLength)
+{
+  uint8_t* token = op++;
+  size_t matchCode = matchLength > 0 ? matchLength - kMinMatch : 0;
+
+  *token = static_cast<uint8_t>(((numLiterals < 15 ? numLiterals : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+  if (numLiterals >= 15) {
+    op = writeLength(op, numLiterals - 15);
+  }
+  if (numLiterals > 0) {
+    memcpy(op, literals, numLiterals);
+    op += numLiterals;
+  }
+
+  if (matchLength > 0) {
+    *op++ = static_cast<uint8_t>(offset & 0xFF);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    if (matchCode >= 15) {
+      op = writeLength(op, matchCode - 15);
+    }
+  }
+
+  return op;
+}
+}
+
+int Codec::FromName(const string& name)
+{
+  if (name == "none") {
+    return CodecNone;
+  } else if (name == "lz") {
+    return CodecLZ;
+  } else if (name == "shuffle-huffman") {
+    return CodecShuffleHuffman;
+  }
+  return -1;
+}
+
+const char* Codec::Name(int codec)
+{
+  switch (codec) {
+    case CodecNone:
+      return "none";
+    case CodecLZ:
+      return "lz";
+    case CodecShuffleHuffman:
+      return "shuffle-huffman";
+    default:
+      return "unknown";
+  }
+}
+
+size_t Codec::MaxCompressedSize(int codec, size_t size)
+{
+  if (codec == CodecShuffleHuffman) {
+    return sizeof(CodecFrame) + compressBound(size);
+  }
+  return sizeof(CodecFrame) + size + size / 255 + 16;
+}
+
+size_t Codec::Compress(int codec, const char* input, size_t size, char* output, int elementSize)
+{
+  if (elementSize < 1 || elementSize > 255) {
+    elementSize = 1;
+  }
+
+  CodecFrame* frame = reinterpret_cast<CodecFrame*>(output);
+  memset(frame, 0, sizeof(CodecFrame));
+  frame->rawSize = size;
+  frame->elementSize = elementSize;
+
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(input);
+  uint8_t* out = reinterpret_cast<uint8_t*>(output) + sizeof(CodecFrame);
+  size_t compressedSize = 0;
+
+  switch (codec) {
+    case CodecLZ:
+      compressedSize = CompressLZ(in, size, out);
+      break;
+    case CodecShuffleHuffman:
+      compressedSize = CompressShuffleHuffman(in, size, out, MaxCompressedSize(codec, size) - sizeof(CodecFrame), elementSize);
+      break;
+    default:
+      return 0;
+  }
+
+  if (compressedSize == 0 || sizeof(CodecFrame) + compressedSize >= size) {
+    return 0;
+  }
+  return sizeof(CodecFrame) + compressedSize;
+}
+
+uint64_t Codec::RawSize(const char* input, size_t size)
+{
+  if (size < sizeof(CodecFrame)) {
+    return 0;
+  }
+  CodecFrame frame;
+  memcpy(&frame, input, sizeof(CodecFrame));
+  return frame.rawSize;
+}
+
+bool Codec::Decompress(int codec, const char* input, size_t size, char* output)
+{
+  if (size < sizeof(CodecFrame)) {
+    return false;
+  }
+  CodecFrame frame;
+  memcpy(&frame, input, sizeof(CodecFrame));
+
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(input) + sizeof(CodecFrame);
+  uint8_t* out = reinterpret_cast<uint8_t*>(output);
+  size -= sizeof(CodecFrame);
+
+  switch (codec) {
+    case CodecLZ:
+      return DecompressLZ(in, size, out, frame.rawSize);
+    case CodecShuffleHuffman:
+      return DecompressShuffleHuffman(in, size, out, frame.rawSize, frame.elementSize);
+    default:
+      return false;
+  }
+}
+
+void Codec::FreeBuffer(void* data, void* /*hint*/)
+{
+  delete[] static_cast<char*>(data);
+}
+
+size_t Codec::CompressLZ(const uint8_t* input, size_t size, uint8_t* output)
+{
+  uint8_t* op = output;
+  const uint8_t* anchor = input;
+
+  if (size > static_cast<size_t>(kMatchSearchLimit)) {
+    uint32_t table[1 << kHashLog] = {};
+    const uint8_t* ip = input + 1;
+    const uint8_t* searchLimit = input + size - kMatchSearchLimit;
+    const uint8_t* matchLimit = input + size - kLastLiterals;
+
+    while (ip < searchLimit) {
+      uint32_t sequence = read32(ip);
+      uint32_t h = hash32(sequence);
+      const uint8_t* ref = input + table[h];
+      table[h] = static_cast<uint32_t>(ip - input);
+
+      if (ip - ref > static_cast<ptrdiff_t>(kMaxOffset) || read32(ref) != sequence) {
+        // skip faster through data without matches.
+        ip += 1 + ((ip - anchor) >> 6);
+        continue;
+      }
+
+      size_t matchLength = kMinMatch;
+      while (ip + matchLength < matchLimit && ip[matchLength] == ref[matchLength]) {
+        ++matchLength;
+      }
+
+      op = writeSequence(op, anchor, ip - anchor, ip - ref, matchLength);
+      ip += matchLength;
+      anchor = ip;
+    }
+  }
+
+  op = writeSequence(op, anchor, input + size - anchor, 0, 0);
+
+  return op - output;
+}
+
+bool Codec::DecompressLZ(const uint8_t* input, size_t size, uint8_t* output, size_t rawSize)
+{
+  const uint8_t* ip = input;
+  const uint8_t* iend = input + size;
+  uint8_t* op = output;
+  uint8_t* oend = output + rawSize;
+
+  while (ip < iend) {
+    uint8_t token = *ip++;
+
+    size_t numLiterals = token >> 4;
+    if (numLiterals == 15 && !readLength(ip, iend, numLiterals)) {
+      return false;
+    }
+    if (numLiterals > static_cast<size_t>(iend - ip) || numLiterals > static_cast<size_t>(oend - op)) {
+      return false;
+    }
+    memcpy(op, ip, numLiterals);
+    ip += numLiterals;
+    op += numLiterals;
+
+    if (ip == iend) {
+      // the last sequence has no match.
+      return op == oend;
+    }
+
+    if (iend - ip < 2) {
+      return false;
+    }
+    size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<size_t>(op - output)) {
+      return false;
+    }
+
+    size_t matchLength = token & 15;
+    if (matchLength == 15 && !readLength(ip, iend, matchLength)) {
+      return false;
+    }
+    matchLength += kMinMatch;
+    if (matchLength > static_cast<size_t>(oend - op)) {
+      return false;
+    }
+
+    const uint8_t* match = op - offset;
+    if (offset >= matchLength) {
+      memcpy(op, match, matchLength);
+      op += matchLength;
+    } else {
+      // overlapping match, repeats the last offset bytes.
+      for (size_t i = 0; i < matchLength; ++i) {
+        *op++ = *match++;
+      }
+    }
+  }
+
+  return false;
+}
+
+size_t Codec::CompressShuffleHuffman(const uint8_t* input, size_t size, uint8_t* output, size_t capacity, int elementSize)
+{
+  if (size > UINT32_MAX || capacity > UINT32_MAX) {
+    return 0;
+  }
+
+  // group the n-th bytes of all elements, the slowly varying high bytes of detector data then compress well.
+  static thread_local vector<uint8_t> shuffled;
+  shuffled.resize(size);
+
+  size_t numElements = size / elementSize;
+  for (int b = 0; b < elementSize; ++b) {
+    uint8_t* dst = shuffled.data() + b * numElements;
+    for (size_t i = 0; i < numElements; ++i) {
+      dst[i] = input[i * elementSize + b];
+    }
+  }
+  if (size > numElements * elementSize) {
+    memcpy(shuffled.data() + numElements * elementSize, input + numElements * elementSize, size - numElements * elementSize);
+  }
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, -15, 8, Z_HUFFMAN_ONLY) != Z_OK) {
+    return 0;
+  }
+
+  stream.next_in = shuffled.data();
+  stream.avail_in = static_cast<uInt>(size);
+  stream.next_out = output;
+  stream.avail_out = static_cast<uInt>(capacity);
+
+  int result = deflate(&stream, Z_FINISH);
+  size_t compressedSize = stream.total_out;
+  deflateEnd(&stream);
+
+  return result == Z_STREAM_END ? compressedSize : 0;
+}
+
+bool Codec::DecompressShuffleHuffman(const uint8_t* input, size_t size, uint8_t* output, size_t rawSize, int elementSize)
+{
+  if (elementSize < 1 || size > UINT32_MAX || rawSize > UINT32_MAX) {
+    return false;
+  }
+
+  static thread_local vector<uint8_t> shuffled;
+  shuffled.resize(rawSize);
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, -15) != Z_OK) {
+    return false;
+  }
+
+  stream.next_in = const_cast<uint8_t*>(input);
+  stream.avail_in = static_cast<uInt>(size);
+  stream.next_out = shuffled.data();
+  stream.avail_out = static_cast<uInt>(rawSize);
+
+  int result = inflate(&stream, Z_FINISH);
+  bool complete = (result == Z_STREAM_END && stream.total_out == rawSize);
+  inflateEnd(&stream);
+
+  if (!complete) {
+    return false;
+  }
+
+  size_t numElements = rawSize / elementSize;
+  for (int b = 0; b < elementSize; ++b) {
+    const uint8_t* src = shuffled.data() + b * numElements;
+    for (size_t i = 0; i < numElements; ++i) {
+      output[i * elementSize + b] = src[i];
+    }
+  }
+  if (rawSize > numElements * elementSize) {
+    memcpy(output + numElements * elementSize, shuffled.data() + numElements * elementSize, rawSize - numElements * elementSize);
+  }
+
+  return true;
+}
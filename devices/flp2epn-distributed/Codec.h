@@ -0,0 +1,81 @@
+/**
+ * Codec.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef ALICEO2_DEVICES_CODEC_H_
+#define ALICEO2_DEVICES_CODEC_H_
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace AliceO2 {
+namespace Devices {
+
+/// Codecs for sub-timeframe bodies, identified in the F2EHeader
+enum Codecs {
+  CodecNone = 0, ///< uncompressed
+  CodecLZ = 1, ///< fast LZ77 block codec (LZ4-like format, without entropy coding)
+  CodecShuffleHuffman = 2 ///< byte shuffle by element size, followed by Huffman coding (zlib, Huffman-only)
+};
+
+/// Compression and decompression of sub-timeframe bodies
+///
+/// A compressed body starts with a CodecFrame, which holds the uncompressed size. Bodies that do not get smaller
+/// are sent uncompressed (codec CodecNone in the header). Stateless and thread-safe.
+
+class Codec
+{
+  public:
+    /// Precedes the compressed data
+    struct CodecFrame
+    {
+      uint64_t rawSize; ///< Size of the uncompressed data
+      uint8_t elementSize; ///< Element size of the byte shuffle (CodecShuffleHuffman)
+      uint8_t reserved[7]; ///< Padding, set to 0
+    };
+
+    /// Codec ID from its name ("none", "lz" or "shuffle-huffman")
+    /// @return -1 if the name is unknown
+    static int FromName(const std::string& name);
+    /// Name of a codec ID
+    static const char* Name(int codec);
+
+    /// Size of the output buffer needed to compress size bytes
+    static size_t MaxCompressedSize(int codec, size_t size);
+    /// Compresses a buffer
+    /// @param codec        Codec ID (not CodecNone)
+    /// @param input        Data to compress
+    /// @param size         Size of the data
+    /// @param output       Output buffer of MaxCompressedSize(codec, size) bytes
+    /// @param elementSize  Element size for the byte shuffle, in bytes
+    /// @return             Size of the compressed data with its frame, 0 if it is not smaller than the input
+    static size_t Compress(int codec, const char* input, size_t size, char* output, int elementSize);
+    /// Uncompressed size of compressed data
+    /// @return 0 if the data is too short to hold a frame
+    static uint64_t RawSize(const char* input, size_t size);
+    /// Decompresses a buffer
+    /// @param codec    Codec ID from the header (not CodecNone)
+    /// @param input    Compressed data with its frame
+    /// @param size     Size of the compressed data
+    /// @param output   Output buffer of RawSize(input, size) bytes
+    /// @return         false if the data is corrupt
+    static bool Decompress(int codec, const char* input, size_t size, char* output);
+
+    /// Free function for messages owning a buffer allocated with new[]
+    static void FreeBuffer(void* data, void* hint);
+
+  private:
+    static size_t CompressLZ(const uint8_t* input, size_t size, uint8_t* output);
+    static bool DecompressLZ(const uint8_t* input, size_t size, uint8_t* output, size_t rawSize);
+    static size_t CompressShuffleHuffman(const uint8_t* input, size_t size, uint8_t* output, size_t capacity, int elementSize);
+    static bool DecompressShuffleHuffman(const uint8_t* input, size_t size, uint8_t* output, size_t rawSize, int elementSize);
+};
+
+} // namespace Devices
+} // namespace AliceO2
+
+#endif
@@ -0,0 +1,105 @@
+/**
+ * CompressionPool.cxx
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#include <boost/bind.hpp>
+
+#include "FairMQMessage.h"
+
+#include "CompressionPool.h"
+#include "Codec.h"
+
+using namespace std;
+using namespace AliceO2::Devices;
+
+CompressionPool::CompressionPool()
+  : fJobs()
+  , fMutex()
+  , fJobAvailable()
+  , fStop(false)
+  , fWorkers()
+{
+}
+
+CompressionPool::~CompressionPool()
+{
+  Stop();
+}
+
+void CompressionPool::Start(int numThreads)
+{
+  Stop();
+
+  fStop = false;
+  for (int i = 0; i < numThreads; ++i) {
+    fWorkers.create_thread(boost::bind(&CompressionPool::Work, this));
+  }
+}
+
+void CompressionPool::Stop()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(fMutex);
+    fStop = true;
+  }
+  fJobAvailable.notify_all();
+  fWorkers.join_all();
+}
+
+void CompressionPool::Submit(Job* job)
+{
+  job->output = nullptr;
+  job->outputSize = 0;
+  job->done.store(false, memory_order_relaxed);
+
+  {
+    boost::lock_guard<boost::mutex> lock(fMutex);
+    fJobs.push_back(job);
+  }
+  fJobAvailable.notify_one();
+}
+
+void CompressionPool::Wait(const Job& job)
+{
+  while (!job.Done()) {
+    boost::this_thread::yield();
+  }
+}
+
+void CompressionPool::Work()
+{
+  while (true) {
+    Job* job;
+
+    {
+      boost::unique_lock<boost::mutex> lock(fMutex);
+      while (fJobs.empty() && !fStop) {
+        fJobAvailable.wait(lock);
+      }
+      // submitted jobs are finished before stopping, the sending thread may be waiting for them.
+      if (fJobs.empty()) {
+        break;
+      }
+      job = fJobs.front();
+      fJobs.pop_front();
+    }
+
+    const char* input = static_cast<const char*>(job->data->GetData());
+    size_t size = job->data->GetSize();
+
+    char* output = new char[Codec::MaxCompressedSize(job->codec, size)];
+    size_t outputSize = Codec::Compress(job->codec, input, size, output, job->elementSize);
+
+    if (outputSize > 0) {
+      job->output = output;
+      job->outputSize = outputSize;
+    } else {
+      delete[] output;
+    }
+
+    job->done.store(true, memory_order_release);
+  }
+}
@@ -0,0 +1,71 @@
+/**
+ * CompressionPool.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef ALICEO2_DEVICES_COMPRESSIONPOOL_H_
+#define ALICEO2_DEVICES_COMPRESSIONPOOL_H_
+
+#include <deque>
+#include <atomic>
+#include <cstddef>
+
+#include <boost/thread.hpp>
+
+class FairMQMessage;
+
+namespace AliceO2 {
+namespace Devices {
+
+/// Worker threads compressing sub-timeframe bodies
+///
+/// The sending thread submits a Job and keeps it (and its message) untouched until Done() returns true,
+/// then takes over the output buffer. Jobs are processed in submission order by any free worker.
+
+class CompressionPool
+{
+  public:
+    /// Compression of one message body
+    struct Job
+    {
+      FairMQMessage* data; ///< Message with the data, read by the worker
+      int codec; ///< Codec ID
+      int elementSize; ///< Element size for the byte shuffle
+      char* output; ///< Compressed data (allocated with new[]), nullptr if the data did not get smaller
+      size_t outputSize; ///< Size of the compressed data
+      std::atomic<bool> done; ///< Set by the worker when output is valid
+
+      bool Done() const { return done.load(std::memory_order_acquire); }
+    };
+
+    /// Default constructor
+    CompressionPool();
+    /// Destructor, stops the workers
+    ~CompressionPool();
+
+    /// Starts the worker threads
+    void Start(int numThreads);
+    /// Stops the worker threads, after they finished the submitted jobs
+    void Stop();
+    /// Queues a job for the workers
+    void Submit(Job* job);
+    /// Waits until a job is done
+    static void Wait(const Job& job);
+
+  private:
+    /// Worker thread
+    void Work();
+
+    std::deque<Job*> fJobs; ///< Submitted jobs, oldest first
+    boost::mutex fMutex; ///< Protects fJobs and fStop
+    boost::condition_variable fJobAvailable; ///< Signalled when a job is submitted or the workers stop
+    bool fStop; ///< true when the workers should finish
+    boost::thread_group fWorkers; ///< Worker threads
+};
+
+} // namespace Devices
+} // namespace AliceO2
+
+#endif
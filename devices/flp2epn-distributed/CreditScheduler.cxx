@@ -0,0 +1,118 @@
+/**
+ * CreditScheduler.cxx
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#include <algorithm> // upper_bound
+#include <utility> // make_pair
+
+#include "CreditScheduler.h"
+
+using namespace std;
+using namespace AliceO2::Devices;
+
+CreditScheduler::CreditScheduler()
+  : fCredits()
+  , fEligible()
+  , fEligibleIndices()
+  , fCumulativeWeights()
+  , fLastAdded()
+  , fPending()
+  , fLastId(0)
+  , fStarted(false)
+  , fWeightsValid(false)
+{
+}
+
+void CreditScheduler::Init(int numEPNs)
+{
+  // until the first advertisements arrive all epnReceivers are equal, which is the same for every flpSender.
+  fCredits.assign(numEPNs, 1);
+  SetEligible(vector<bool>(numEPNs, true));
+  fCumulativeWeights.assign(numEPNs, 0);
+  Update none;
+  none.epnIndex = -1;
+  none.validFromId = 0;
+  none.credits = 0;
+  fLastAdded.assign(numEPNs, none);
+  fPending.clear();
+  fLastId = 0;
+  fStarted = false;
+  fWeightsValid = false;
+}
+
+bool CreditScheduler::Add(const Update& update)
+{
+  if (update.epnIndex < 0 || update.epnIndex >= static_cast<int>(fCredits.size())) {
+    return true;
+  }
+
+  // every heartbeat repeats the advertisement until the epnReceiver gets new timeframes.
+  Update& last = fLastAdded[update.epnIndex];
+  if (last.epnIndex >= 0
+      && (update.validFromId < last.validFromId || (update.validFromId == last.validFromId && update.credits == last.credits))) {
+    return true;
+  }
+  last = update;
+
+  if (fStarted && update.validFromId <= fLastId) {
+    // applying it from a later ID than the other flpSenders would select differently from them until the next update.
+    return false;
+  }
+
+  fPending[make_pair(update.validFromId, update.epnIndex)] = update.credits;
+  return true;
+}
+
+void CreditScheduler::SetEligible(const vector<bool>& eligible)
+{
+  fEligible = eligible;
+  fEligibleIndices.clear();
+  for (size_t i = 0; i < fEligible.size(); ++i) {
+    if (fEligible[i]) {
+      fEligibleIndices.push_back(i);
+    }
+  }
+  fWeightsValid = false;
+}
+
+void CreditScheduler::UpdateWeights()
+{
+  uint64_t sum = 0;
+  for (size_t i = 0; i < fCredits.size(); ++i) {
+    if (fCredits[i] > 0 && fEligible[i]) {
+      sum += fCredits[i];
+    }
+    fCumulativeWeights[i] = sum;
+  }
+  fWeightsValid = true;
+}
+
+int CreditScheduler::Select(uint64_t id)
+{
+  fLastId = id;
+  fStarted = true;
+
+  while (!fPending.empty() && fPending.begin()->first.first <= id) {
+    fCredits[fPending.begin()->first.second] = fPending.begin()->second;
+    fWeightsValid = false;
+    fPending.erase(fPending.begin());
+  }
+
+  if (!fWeightsValid) {
+    UpdateWeights();
+  }
+
+  const uint64_t total = fCumulativeWeights.back();
+
+  if (total == 0) {
+    return fEligibleIndices[id % fEligibleIndices.size()];
+  }
+
+  // spread consecutive IDs over the credit range (multiplicative hashing), then pick the epnReceiver owning that credit.
+  const uint64_t point = (id * 2654435761u) % total;
+
+  return upper_bound(fCumulativeWeights.begin(), fCumulativeWeights.end(), point) - fCumulativeWeights.begin();
+}
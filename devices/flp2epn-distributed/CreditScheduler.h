@@ -0,0 +1,84 @@
+/**
+ * CreditScheduler.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef ALICEO2_DEVICES_CREDITSCHEDULER_H_
+#define ALICEO2_DEVICES_CREDITSCHEDULER_H_
+
+#include <vector>
+#include <map>
+#include <utility> // pair
+#include <cstdint>
+
+namespace AliceO2 {
+namespace Devices {
+
+/// Load-aware selection of the target epnReceiver for a timeframe
+///
+/// epnReceivers advertise their free buffer slots (credits) in the heartbeats, stamped with the timeframe ID
+/// from which the new value applies. Every flpSender applies an update exactly at that ID and selects the
+/// target with a deterministic function of the timeframe ID and the credit table, so all flpSenders that
+/// received the same updates in time pick the same epnReceiver for a given timeframe. An update that arrives
+/// after its ID was passed is dropped: the previous credits stay until the next update that arrives in time.
+/// An epnReceiver without credits gets no timeframes. Without any credits the selection falls back to round-robin.
+/// Only eligible epnReceivers (the members of the MembershipTable) are selected.
+/// Only used from the sending thread.
+
+class CreditScheduler
+{
+  public:
+    /// Credit advertisement of one epnReceiver
+    struct Update
+    {
+      int epnIndex; ///< Index of the epnReceiver in the data-out channels
+      uint64_t validFromId; ///< First timeframe ID for which the credits apply
+      int credits; ///< Number of free timeframe slots
+    };
+
+    /// Default constructor
+    CreditScheduler();
+
+    /// Initializes the credit table with equal credits for every epnReceiver
+    /// @param numEPNs  Number of epnReceivers
+    void Init(int numEPNs);
+
+    /// Queues a credit update, to be applied when its timeframe ID is reached.
+    /// Repeated and superseded advertisements of an epnReceiver are ignored.
+    /// @return false if the ID was already passed, the update is then dropped
+    bool Add(const Update& update);
+
+    /// Restricts the selection to the given epnReceivers
+    /// @param eligible true for the epnReceivers that can be selected, at least one
+    void SetEligible(const std::vector<bool>& eligible);
+
+    /// Selects the epnReceiver for the given timeframe, after applying all updates due at this ID.
+    /// IDs are expected in sending order.
+    /// @param id   Timeframe ID
+    /// @return     Index of the epnReceiver
+    int Select(uint64_t id);
+
+    /// Current credits of an epnReceiver
+    int Credits(int epnIndex) const { return fCredits.at(epnIndex); }
+
+  private:
+    /// Recomputes the cumulative weights after the credits changed
+    void UpdateWeights();
+
+    std::vector<int> fCredits; ///< Credits per epnReceiver
+    std::vector<bool> fEligible; ///< true for the epnReceivers that can be selected
+    std::vector<int> fEligibleIndices; ///< Indices of the eligible epnReceivers, for the round-robin fallback
+    std::vector<uint64_t> fCumulativeWeights; ///< Running sum of the credits, for the weighted selection
+    std::vector<Update> fLastAdded; ///< Last queued update per epnReceiver (epnIndex -1 - none yet)
+    std::map<std::pair<uint64_t, int>, int> fPending; ///< Credits not yet due, by the timeframe ID from which they apply and the epnReceiver
+    uint64_t fLastId; ///< Last timeframe ID passed to Select()
+    bool fStarted; ///< true after the first Select()
+    bool fWeightsValid; ///< false if the credits changed since the last UpdateWeights()
+};
+
+} // namespace Devices
+} // namespace AliceO2
+
+#endif
@@ -0,0 +1,204 @@
+/**
+ * DeviceMetrics.cxx
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#include <sstream>
+#include <chrono>
+#include <cstring> // memcpy
+
+#include <boost/bind.hpp>
+
+#include "FairMQLogger.h"
+#include "FairMQChannel.h"
+#include "FairMQTransportFactory.h"
+
+#include "DeviceMetrics.h"
+
+using namespace std;
+using namespace AliceO2::Devices;
+
+DeviceMetrics::Histogram::Histogram(const vector<uint64_t>& bounds)
+  : fBounds(bounds)
+  , fCounts(new atomic<uint64_t>[bounds.size() + 1])
+  , fSum(0)
+{
+  for (size_t i = 0; i <= fBounds.size(); ++i) {
+    fCounts[i].store(0);
+  }
+}
+
+DeviceMetrics::DeviceMetrics()
+  : fCounters()
+  , fGauges()
+  , fHistograms()
+  , fDeviceId()
+  , fIntervalInMs(1000)
+  , fFile()
+  , fChannel(nullptr)
+  , fTransportFactory(nullptr)
+  , fPublisher()
+  , fPublishing(false)
+{
+}
+
+DeviceMetrics::~DeviceMetrics()
+{
+  StopPublishing();
+}
+
+DeviceMetrics::Counter& DeviceMetrics::AddCounter(const string& name)
+{
+  fCounters.push_back(make_pair(name, unique_ptr<Counter>(new Counter())));
+  return *(fCounters.back().second);
+}
+
+DeviceMetrics::Gauge& DeviceMetrics::AddGauge(const string& name)
+{
+  fGauges.push_back(make_pair(name, unique_ptr<Gauge>(new Gauge())));
+  return *(fGauges.back().second);
+}
+
+DeviceMetrics::Histogram& DeviceMetrics::AddHistogram(const string& name, const vector<uint64_t>& bounds)
+{
+  fHistograms.push_back(make_pair(name, unique_ptr<Histogram>(new Histogram(bounds))));
+  return *(fHistograms.back().second);
+}
+
+void DeviceMetrics::Clear()
+{
+  fCounters.clear();
+  fGauges.clear();
+  fHistograms.clear();
+}
+
+vector<uint64_t> DeviceMetrics::ExponentialBounds(uint64_t first, double factor, int count)
+{
+  vector<uint64_t> bounds;
+  double bound = first;
+
+  for (int i = 0; i < count; ++i) {
+    uint64_t value = static_cast<uint64_t>(bound);
+    // small bounds could repeat after rounding, keep them strictly ascending.
+    if (!bounds.empty() && value <= bounds.back()) {
+      value = bounds.back() + 1;
+    }
+    bounds.push_back(value);
+    bound *= factor;
+  }
+
+  return bounds;
+}
+
+void DeviceMetrics::Write(ostream& out, const string& deviceId) const
+{
+  int64_t timestamp = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+
+  out << "{\"device\":\"" << deviceId << "\",\"timestamp\":" << timestamp;
+
+  out << ",\"counters\":{";
+  for (size_t i = 0; i < fCounters.size(); ++i) {
+    out << (i > 0 ? "," : "") << "\"" << fCounters[i].first << "\":" << fCounters[i].second->Value();
+  }
+
+  out << "},\"gauges\":{";
+  for (size_t i = 0; i < fGauges.size(); ++i) {
+    out << (i > 0 ? "," : "") << "\"" << fGauges[i].first << "\":" << fGauges[i].second->Value();
+  }
+
+  out << "},\"histograms\":{";
+  for (size_t i = 0; i < fHistograms.size(); ++i) {
+    const Histogram& histogram = *(fHistograms[i].second);
+    const vector<uint64_t>& bounds = histogram.Bounds();
+
+    out << (i > 0 ? "," : "") << "\"" << fHistograms[i].first << "\":{\"bounds\":[";
+    for (size_t j = 0; j < bounds.size(); ++j) {
+      out << (j > 0 ? "," : "") << bounds[j];
+    }
+    out << "],\"counts\":[";
+    for (size_t j = 0; j <= bounds.size(); ++j) {
+      out << (j > 0 ? "," : "") << histogram.Count(j);
+    }
+    out << "],\"sum\":" << histogram.Sum() << "}";
+  }
+
+  out << "}}\n";
+}
+
+void DeviceMetrics::StartPublishing(const string& deviceId, int intervalInMs, const string& fileName,
+                                    FairMQChannel* channel, FairMQTransportFactory* factory)
+{
+  StopPublishing();
+
+  fDeviceId = deviceId;
+  fIntervalInMs = intervalInMs > 0 ? intervalInMs : 1000;
+  fChannel = channel;
+  fTransportFactory = factory;
+
+  if (!fileName.empty()) {
+    fFile.open(fileName.c_str(), ios::out | ios::app);
+    if (!fFile) {
+      LOG(ERROR) << "Could not open metrics file " << fileName;
+    }
+  }
+
+  if (!fFile.is_open() && !fChannel) {
+    return;
+  }
+
+  fPublishing = true;
+  fPublisher = boost::thread(boost::bind(&DeviceMetrics::PublishLoop, this));
+}
+
+void DeviceMetrics::StopPublishing()
+{
+  if (!fPublishing) {
+    return;
+  }
+
+  fPublisher.interrupt();
+  fPublisher.join();
+  fPublishing = false;
+
+  // the final values, including what happened since the last interval.
+  Publish();
+
+  if (fFile.is_open()) {
+    fFile.close();
+  }
+  fChannel = nullptr;
+}
+
+void DeviceMetrics::Publish()
+{
+  ostringstream record;
+  Write(record, fDeviceId);
+
+  if (fFile.is_open()) {
+    fFile << record.str();
+    fFile.flush();
+  }
+
+  if (fChannel) {
+    string str = record.str();
+    FairMQMessage* msg = fTransportFactory->CreateMessage(str.size());
+    memcpy(msg->GetData(), str.data(), str.size());
+    // a metrics consumer that does not keep up must not stall the device, records are dropped instead.
+    fChannel->Send(msg, fChannel->fSocket->NOBLOCK);
+    delete msg;
+  }
+}
+
+void DeviceMetrics::PublishLoop()
+{
+  while (true) {
+    try {
+      boost::this_thread::sleep(boost::posix_time::milliseconds(fIntervalInMs));
+      Publish();
+    } catch (boost::thread_interrupted&) {
+      break;
+    }
+  }
+}
@@ -0,0 +1,155 @@
+/**
+ * DeviceMetrics.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef ALICEO2_DEVICES_DEVICEMETRICS_H_
+#define ALICEO2_DEVICES_DEVICEMETRICS_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <fstream>
+#include <ostream>
+#include <utility> // pair
+#include <algorithm> // upper_bound
+#include <cstdint>
+
+#include <boost/thread.hpp>
+
+class FairMQChannel;
+class FairMQTransportFactory;
+
+namespace AliceO2 {
+namespace Devices {
+
+/// Registry of device metrics (counters, gauges and fixed-bucket histograms)
+///
+/// Metrics are registered before the device runs (not thread-safe) and keep their address until Clear().
+/// Updating them is a relaxed atomic operation without locks or allocations, so they can be updated on the
+/// hot path from any thread. A publisher thread periodically writes a snapshot of all metrics as one JSON line
+/// to a file and/or sends it as a message on a channel. Counters and histograms are cumulative since the start.
+
+class DeviceMetrics
+{
+  public:
+    /// Monotonically increasing value
+    class Counter
+    {
+      public:
+        Counter() : fValue(0) {}
+        void Add(uint64_t n = 1) { fValue.fetch_add(n, std::memory_order_relaxed); }
+        uint64_t Value() const { return fValue.load(std::memory_order_relaxed); }
+
+      private:
+        std::atomic<uint64_t> fValue;
+    };
+
+    /// Current value of a quantity (e.g. buffer occupancy)
+    class Gauge
+    {
+      public:
+        Gauge() : fValue(0) {}
+        void Set(int64_t value) { fValue.store(value, std::memory_order_relaxed); }
+        int64_t Value() const { return fValue.load(std::memory_order_relaxed); }
+
+      private:
+        std::atomic<int64_t> fValue;
+    };
+
+    /// Histogram with fixed bucket bounds
+    ///
+    /// Bucket i counts values <= bounds[i] (and > bounds[i - 1]), the last bucket counts values above all bounds.
+    class Histogram
+    {
+      public:
+        /// Constructor
+        /// @param bounds   Upper bounds of the buckets, ascending
+        explicit Histogram(const std::vector<uint64_t>& bounds);
+
+        /// Records a value
+        void Record(uint64_t value)
+        {
+          size_t index = std::lower_bound(fBounds.begin(), fBounds.end(), value) - fBounds.begin();
+          fCounts[index].fetch_add(1, std::memory_order_relaxed);
+          fSum.fetch_add(value, std::memory_order_relaxed);
+        }
+
+        const std::vector<uint64_t>& Bounds() const { return fBounds; }
+        /// Count of bucket i (bounds().size() + 1 buckets)
+        uint64_t Count(size_t i) const { return fCounts[i].load(std::memory_order_relaxed); }
+        /// Sum of all recorded values
+        uint64_t Sum() const { return fSum.load(std::memory_order_relaxed); }
+
+      private:
+        std::vector<uint64_t> fBounds;
+        std::unique_ptr<std::atomic<uint64_t>[]> fCounts;
+        std::atomic<uint64_t> fSum;
+    };
+
+    /// Default constructor
+    DeviceMetrics();
+    /// Destructor, stops the publisher
+    ~DeviceMetrics();
+
+    /// Registers a counter
+    /// @param name Metric name (used as JSON key, without quotes or backslashes)
+    Counter& AddCounter(const std::string& name);
+    /// Registers a gauge
+    /// @param name Metric name (used as JSON key, without quotes or backslashes)
+    Gauge& AddGauge(const std::string& name);
+    /// Registers a histogram
+    /// @param name     Metric name (used as JSON key, without quotes or backslashes)
+    /// @param bounds   Upper bounds of the buckets, ascending
+    Histogram& AddHistogram(const std::string& name, const std::vector<uint64_t>& bounds);
+    /// Removes all metrics, call only while not publishing
+    void Clear();
+
+    /// Bucket bounds growing by a constant factor
+    /// @param first    Upper bound of the first bucket
+    /// @param factor   Ratio between consecutive bounds (> 1)
+    /// @param count    Number of bounds
+    static std::vector<uint64_t> ExponentialBounds(uint64_t first, double factor, int count);
+
+    /// Writes a snapshot of all metrics as one line of JSON
+    /// @param out      Output stream
+    /// @param deviceId Device ID, included in the record
+    void Write(std::ostream& out, const std::string& deviceId) const;
+
+    /// Starts the publisher thread, does nothing if neither a file nor a channel is given
+    /// @param deviceId     Device ID, included in the records
+    /// @param intervalInMs Publishing interval
+    /// @param fileName     File the records are appended to (empty - none)
+    /// @param channel      Channel the records are sent on (nullptr - none), used only by the publisher thread
+    /// @param factory      Transport factory to create the messages for the channel
+    void StartPublishing(const std::string& deviceId, int intervalInMs, const std::string& fileName,
+                         FairMQChannel* channel, FairMQTransportFactory* factory);
+    /// Stops the publisher thread, after publishing a last snapshot
+    void StopPublishing();
+
+  private:
+    /// Writes or sends one snapshot
+    void Publish();
+    /// Publisher thread
+    void PublishLoop();
+
+    std::vector<std::pair<std::string, std::unique_ptr<Counter>>> fCounters; ///< Registered counters, in registration order
+    std::vector<std::pair<std::string, std::unique_ptr<Gauge>>> fGauges; ///< Registered gauges, in registration order
+    std::vector<std::pair<std::string, std::unique_ptr<Histogram>>> fHistograms; ///< Registered histograms, in registration order
+
+    std::string fDeviceId; ///< Device ID, included in the records
+    int fIntervalInMs; ///< Publishing interval
+    std::ofstream fFile; ///< Output file, if open
+    FairMQChannel* fChannel; ///< Output channel, if any
+    FairMQTransportFactory* fTransportFactory; ///< Factory for the output messages
+    boost::thread fPublisher; ///< Publisher thread
+    bool fPublishing; ///< true while the publisher thread runs
+};
+
+} // namespace Devices
+} // namespace AliceO2
+
+#endif
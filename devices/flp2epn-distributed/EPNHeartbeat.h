@@ -0,0 +1,31 @@
+/**
+ * EPNHeartbeat.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef ALICEO2_DEVICES_EPNHEARTBEAT_H_
+#define ALICEO2_DEVICES_EPNHEARTBEAT_H_
+
+#include <cstdint>
+
+namespace AliceO2 {
+namespace Devices {
+
+/// Heartbeat sent by the epnReceivers to the flpSenders
+///
+/// The struct is followed in the message by the data input address of the epnReceiver (not null-terminated),
+/// which the flpSenders use to identify the sender.
+
+struct EPNHeartbeat
+{
+  uint64_t validFromId; ///< First timeframe ID for which the advertised credits apply
+  int32_t credits; ///< Number of free timeframe slots of the epnReceiver
+  uint32_t reserved; ///< Padding, set to 0
+};
+
+} // namespace Devices
+} // namespace AliceO2
+
+#endif
@@ -6,7 +6,8 @@
  */
 
 #include <cstddef> // size_t
-#include <fstream> // writing to file (DEBUG)
+#include <algorithm> // max
+#include <sstream>
 
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
@@ -14,22 +15,64 @@
 #include "FairMQLogger.h"
 
 #include "EPNReceiver.h"
+#include "EPNHeartbeat.h"
+#include "MultipartMessage.h"
+#include "TimeframeFragmentHeader.h"
+#include "F2EHeader.h"
+#include "Codec.h"
 
 using namespace std;
 using namespace AliceO2::Devices;
 
-struct f2eHeader {
-  uint16_t timeFrameId;
-  int      flpIndex;
-};
-
 EPNReceiver::EPNReceiver()
-  : fHeartbeatIntervalInMs(3000)
-  , fBufferTimeoutInMs(5000)
+  : fTimeframeBuffer()
+  , fDiscardedSet()
+  , fDiscardedQueue()
+  , fNumDiscarded(0)
+  , fIncompletePolicyName("discard")
+  , fIncompletePolicy(IncompleteDiscard)
+  , fForwardLateParts(0)
+  , fNumForwarded(0)
+  , fNumLateForwarded(0)
   , fNumFLPs(0)
+  , fBufferTimeoutInMs(5000)
   , fTestMode(0)
-  , fTimeframeBuffer()
-  , fDiscardedSet()
+  , fHeartbeatIntervalInMs(3000)
+  , fBufferWindow(1021)
+  , fSndMoreFlag(0)
+  , fNoBlockFlag(0)
+  , fDispatchQueueSize(0)
+  , fDispatchQueue()
+  , fDispatchQueueMax(0)
+  , fDispatchQueueFull(0)
+  , fSendHeartbeats(1)
+  , fCreditLead(256)
+  , fFreeSlots(0)
+  , fLastTimeframeId(0)
+  , fPublishedTimeframeId(0)
+  , fMetrics()
+  , fMetricsFile()
+  , fMetricsIntervalInMs(1000)
+  , fPartsIn(nullptr)
+  , fBytesIn(nullptr)
+  , fTimeframesBuilt(nullptr)
+  , fTimeframesDiscarded(nullptr)
+  , fTimeframesForwarded(nullptr)
+  , fLatePartsForwarded(nullptr)
+  , fLatePartsRejected(nullptr)
+  , fDuplicateParts(nullptr)
+  , fTimeframesSent(nullptr)
+  , fBytesOut(nullptr)
+  , fBufferOccupancy(nullptr)
+  , fDispatchOccupancy(nullptr)
+  , fBuildTime(nullptr)
+  , fBytesDecompressed(nullptr)
+  , fInterArrival()
+  , fLastArrival()
+  , fDataInTransport("zmq")
+  , fShmSegmentName("flp2epn")
+  , fShmSegmentSize(1024)
+  , fSharedMemory()
 {
 }
 
@@ -37,7 +80,90 @@ EPNReceiver::~EPNReceiver()
 {
 }
 
-void EPNReceiver::PrintBuffer(const unordered_map<uint16_t, TFBuffer>& buffer) const
+void EPNReceiver::InitTask()
+{
+  fTimeframeBuffer.Init(fNumFLPs, fBufferWindow, fBufferTimeoutInMs);
+  fFreeSlots = fBufferWindow;
+
+  if (fDispatchQueueSize > 0) {
+    fDispatchQueue.Resize(fDispatchQueueSize);
+    for (auto& entry : fDispatchQueue.Elements()) {
+      entry.header = nullptr;
+      entry.parts.assign(fNumFLPs, nullptr);
+    }
+  }
+
+  if (fIncompletePolicyName == "discard") {
+    fIncompletePolicy = IncompleteDiscard;
+  } else if (fIncompletePolicyName == "forward") {
+    fIncompletePolicy = IncompleteForward;
+  } else {
+    LOG(ERROR) << "Unknown incomplete policy \"" << fIncompletePolicyName << "\", using discard";
+    fIncompletePolicy = IncompleteDiscard;
+  }
+
+  if (fDataInTransport == "shm") {
+    if (!fSharedMemory || fSharedMemory->Name() != fShmSegmentName) {
+      fSharedMemory.reset(new SharedMemorySegment(fShmSegmentName, static_cast<size_t>(fShmSegmentSize) << 20));
+    }
+  } else {
+    if (fDataInTransport != "zmq") {
+      LOG(ERROR) << "Unknown data-in transport \"" << fDataInTransport << "\", using zmq";
+    }
+    fSharedMemory.reset();
+  }
+
+  InitMetrics();
+}
+
+void EPNReceiver::InitMetrics()
+{
+  fMetrics.Clear();
+
+  fPartsIn = &fMetrics.AddCounter("parts_in");
+  fBytesIn = &fMetrics.AddCounter("bytes_in");
+  fTimeframesBuilt = &fMetrics.AddCounter("timeframes_built");
+  fTimeframesDiscarded = &fMetrics.AddCounter("timeframes_discarded");
+  fTimeframesForwarded = &fMetrics.AddCounter("timeframes_forwarded");
+  fLatePartsForwarded = &fMetrics.AddCounter("late_parts_forwarded");
+  fLatePartsRejected = &fMetrics.AddCounter("late_parts_rejected");
+  fDuplicateParts = &fMetrics.AddCounter("duplicate_parts");
+  fTimeframesSent = &fMetrics.AddCounter("timeframes_sent");
+  fBytesOut = &fMetrics.AddCounter("bytes_out");
+
+  fBufferOccupancy = &fMetrics.AddGauge("buffer_occupancy");
+  fDispatchOccupancy = &fMetrics.AddGauge("dispatch_queue_occupancy");
+
+  // 10 us to ~10 s in 31 buckets, the same bounds for all latencies so the records are easy to compare.
+  vector<uint64_t> bounds = DeviceMetrics::ExponentialBounds(10, 1.6, 31);
+
+  fBuildTime = &fMetrics.AddHistogram("build_time_us", bounds);
+  fBytesDecompressed = &fMetrics.AddCounter("bytes_decompressed");
+
+  fInterArrival.clear();
+  for (int i = 0; i < fNumFLPs; ++i) {
+    fInterArrival.push_back(&fMetrics.AddHistogram("interarrival_us_flp" + to_string(i), bounds));
+  }
+  fLastArrival.assign(fNumFLPs, chrono::steady_clock::time_point());
+}
+
+void EPNReceiver::RecordArrival(int flpIndex, int size, const chrono::steady_clock::time_point& now)
+{
+  fPartsIn->Add();
+  fBytesIn->Add(size);
+
+  if (flpIndex < 0 || flpIndex >= fNumFLPs) {
+    return;
+  }
+
+  // the first part of an flpSender has no interval.
+  if (fLastArrival[flpIndex] != chrono::steady_clock::time_point()) {
+    fInterArrival[flpIndex]->Record(chrono::duration_cast<chrono::microseconds>(now - fLastArrival[flpIndex]).count());
+  }
+  fLastArrival[flpIndex] = now;
+}
+
+void EPNReceiver::PrintBuffer(const TimeframeBuilder& buffer) const
 {
   string header = "===== ";
 
@@ -49,167 +175,449 @@ void EPNReceiver::PrintBuffer(const unordered_map<uint16_t, TFBuffer>& buffer) c
   }
   LOG(INFO) << header;
 
-  for (auto& it : buffer) {
+  for (auto& tf : buffer.Slots()) {
+    if (!tf.inUse) {
+      continue;
+    }
     string stars = "";
-    for (int j = 1; j <= (it.second).parts.size(); ++j) {
-      stars += "*";
+    for (int j = 0; j < fNumFLPs; ++j) {
+      stars += buffer.HasPart(tf, j) ? "*" : " ";
+    }
+    LOG(INFO) << setw(4) << tf.id << ": " << stars;
+  }
+}
+
+void EPNReceiver::ExpireTimeframe(TFBuffer& tf)
+{
+  stringstream missing;
+  for (int i = 0; i < fNumFLPs; ++i) {
+    if (!fTimeframeBuffer.HasPart(tf, i)) {
+      missing << " " << i;
+    }
+  }
+  LOG(WARN) << "Timeframe #" << tf.id << " is missing parts from FLP(s):" << missing.str();
+
+  // remember only as many discarded IDs as the buffer has slots, late parts arrive shortly after the timeout.
+  if (fDiscardedQueue.size() >= static_cast<size_t>(fBufferWindow)) {
+    fDiscardedSet.erase(fDiscardedQueue.front());
+    fDiscardedQueue.pop();
+  }
+  if (fDiscardedSet.insert(tf.id).second) {
+    fDiscardedQueue.push(tf.id);
+  }
+
+  if (fIncompletePolicy == IncompleteForward) {
+    ForwardTimeframe(tf);
+  } else {
+    DiscardTimeframe(tf);
+  }
+}
+
+void EPNReceiver::DiscardTimeframe(TFBuffer& tf)
+{
+  fTimeframeBuffer.Release(tf, true);
+  fTimeframesDiscarded->Add();
+  LOG(WARN) << "Number of discarded timeframes: " << ++fNumDiscarded;
+}
+
+void EPNReceiver::ForwardTimeframe(TFBuffer& tf)
+{
+  FairMQMessage* header = CreateFragmentHeader(tf.id, TimeframeFragmentHeader::IncompleteTimeframe, 0, &tf);
+
+  if (fDispatchQueueSize > 0) {
+    fTimeframeBuffer.Release(tf, !QueueTimeframe(tf.id, header, tf.parts));
+  } else {
+    SendTimeframe(tf.id, header, tf.parts, fChannels.at("data-out").at(0), nullptr);
+    fTimeframeBuffer.Release(tf, false);
+  }
+
+  fTimeframesForwarded->Add();
+  LOG(WARN) << "Number of forwarded incomplete timeframes: " << ++fNumForwarded;
+}
+
+void EPNReceiver::ForwardLatePart(uint64_t id, int flpIndex, FairMQMessage* dataPart)
+{
+  FairMQMessage* header = CreateFragmentHeader(id, TimeframeFragmentHeader::LateFragment, flpIndex, nullptr);
+
+  if (fDispatchQueueSize > 0) {
+    CompletedTimeframe* entry = NextDispatchEntry();
+    if (!entry) {
+      delete header;
+      delete dataPart;
+      return;
     }
-    LOG(INFO) << setw(4) << it.first << ": " << stars;
+    entry->id = id;
+    entry->header = header;
+    entry->parts[flpIndex] = dataPart;
+    fDispatchQueue.Push();
+  } else {
+    vector<FairMQMessage*> parts{ dataPart };
+    SendTimeframe(id, header, parts, fChannels.at("data-out").at(0), nullptr);
   }
+
+  ++fNumLateForwarded;
+  fLatePartsForwarded->Add();
 }
 
-void EPNReceiver::DiscardIncompleteTimeframes()
+FairMQMessage* EPNReceiver::CreateFragmentHeader(uint64_t id, uint16_t type, int flpIndex, const TFBuffer* tf)
 {
-  auto it = fTimeframeBuffer.begin();
-  while (it != fTimeframeBuffer.end()) {
-    if ((boost::posix_time::microsec_clock::local_time() - (it->second).startTime).total_milliseconds() > fBufferTimeoutInMs) {
-      LOG(WARN) << "Timeframe #" << it->first << " incomplete after " << fBufferTimeoutInMs << " milliseconds, discarding";
-      fDiscardedSet.insert(it->first);
-      for (int i = 0; i < (it->second).parts.size(); ++i) {
-        delete (it->second).parts.at(i);
+  vector<uint16_t> missing;
+  if (tf) {
+    for (int i = 0; i < fNumFLPs; ++i) {
+      if (!fTimeframeBuffer.HasPart(*tf, i)) {
+        missing.push_back(i);
       }
-      it->second.parts.clear();
-      fTimeframeBuffer.erase(it++);
-      LOG(WARN) << "Number of discarded timeframes: " << fDiscardedSet.size();
-    } else {
-      // LOG(INFO) << "Timeframe #" << it->first << " within timeout, buffering...";
-      ++it;
     }
   }
+
+  TimeframeFragmentHeader header;
+  header.magic = TimeframeFragmentHeader::MagicNumber;
+  header.type = type;
+  header.numFLPs = fNumFLPs;
+  header.flpIndex = flpIndex;
+  header.reserved = 0;
+  header.numMissing = missing.size();
+  header.timeframeId = id;
+
+  FairMQMessage* msg = fTransportFactory->CreateMessage(sizeof(TimeframeFragmentHeader) + missing.size() * sizeof(uint16_t));
+  memcpy(msg->GetData(), &header, sizeof(TimeframeFragmentHeader));
+  if (!missing.empty()) {
+    memcpy(static_cast<char*>(msg->GetData()) + sizeof(TimeframeFragmentHeader), missing.data(), missing.size() * sizeof(uint16_t));
+  }
+
+  return msg;
+}
+
+void EPNReceiver::DiscardIncompleteTimeframes(const chrono::steady_clock::time_point& now)
+{
+  while (TFBuffer* tf = fTimeframeBuffer.NextExpired(now)) {
+    LOG(WARN) << "Timeframe #" << tf->id << " incomplete after " << fBufferTimeoutInMs << " milliseconds, "
+              << (fIncompletePolicy == IncompleteForward ? "forwarding" : "discarding");
+    ExpireTimeframe(*tf);
+  }
 }
 
 void EPNReceiver::Run()
 {
-  // boost::thread heartbeatSender(boost::bind(&EPNReceiver::sendHeartbeats, this));
+  boost::thread heartbeatSender;
+  if (fSendHeartbeats > 0) {
+    heartbeatSender = boost::thread(boost::bind(&EPNReceiver::sendHeartbeats, this));
+  }
+  bool receivingIds = fSendHeartbeats > 0 && fChannels.count("id-in") > 0;
+  boost::thread idReceiver;
+  if (receivingIds) {
+    idReceiver = boost::thread(boost::bind(&EPNReceiver::receiveTimeframeIds, this));
+  }
 
   FairMQPoller* poller = fTransportFactory->CreatePoller(fChannels.at("data-in"));
 
-  int SNDMORE = fChannels.at("data-in").at(0).fSocket->SNDMORE;
-  int NOBLOCK = fChannels.at("data-in").at(0).fSocket->NOBLOCK;
+  fSndMoreFlag = fChannels.at("data-in").at(0).fSocket->SNDMORE;
+  fNoBlockFlag = fChannels.at("data-in").at(0).fSocket->NOBLOCK;
 
-  // DEBUG: store receive intervals per FLP
-  // vector<vector<int>> rcvIntervals(fNumFLPs, vector<int>());
-  // vector<boost::posix_time::ptime> rcvTimestamp(fNumFLPs);
-  // end DEBUG
+  fLastArrival.assign(fNumFLPs, chrono::steady_clock::time_point());
+  FairMQChannel* metricsOutChannel = (fChannels.count("metrics-out") > 0) ? &(fChannels.at("metrics-out").at(0)) : nullptr;
+  fMetrics.StartPublishing(fId, fMetricsIntervalInMs, fMetricsFile, metricsOutChannel, fTransportFactory);
 
-  f2eHeader* h; // holds the header of the currently arrived message.
-  uint16_t id = 0; // holds the timeframe id of the currently arrived sub-timeframe.
+  F2EHeader* h; // holds the header of the currently arrived message.
+  uint64_t id = 0; // holds the timeframe id of the currently arrived sub-timeframe.
   int rcvDataSize = 0;
 
   FairMQChannel& dataInputChannel = fChannels.at("data-in").at(0);
   FairMQChannel& dataOutChannel = fChannels.at("data-out").at(0);
-  FairMQChannel& ackOutChannel = fChannels.at("ack-out").at(0);
+  FairMQChannel* ackOutChannel = (fTestMode > 0) ? &(fChannels.at("ack-out").at(0)) : nullptr;
+
+  // in pipelined mode the output channels are used only by the dispatch thread
+  boost::thread dispatcher;
+  if (fDispatchQueueSize > 0) {
+    dispatcher = boost::thread(boost::bind(&EPNReceiver::Dispatch, this));
+  }
+
+  chrono::steady_clock::time_point now;
+  chrono::steady_clock::time_point lastQueueReport = chrono::steady_clock::now();
 
   while (CheckCurrentState(RUNNING)) {
     poller->Poll(100);
 
+    now = chrono::steady_clock::now();
+
     if (poller->CheckInput(0)) {
       FairMQMessage* headerPart = fTransportFactory->CreateMessage();
 
-      if (dataInputChannel.Receive(headerPart) > 0) {
-        // store the received ID
-        h = static_cast<f2eHeader*>(headerPart->GetData());
-        id = h->timeFrameId;
-        // LOG(INFO) << "Received sub-time frame #" << id << " from FLP" << h->flpIndex;
+      int rcvHeaderSize = dataInputChannel.Receive(headerPart);
 
-        // DEBUG:: store receive intervals per FLP
-        // if (fTestMode > 0) {
-        //   int flp_id = h->flpIndex;
-        //   if (to_simple_string(rcvTimestamp.at(flp_id)) != "not_a_date_time") {
-        //     rcvIntervals.at(flp_id).push_back( (boost::posix_time::microsec_clock::local_time() - rcvTimestamp.at(flp_id)).total_microseconds() );
-        //     // LOG(WARN) << rcvIntervals.at(flp_id).back();
-        //   }
-        //   rcvTimestamp.at(flp_id) = boost::posix_time::microsec_clock::local_time();
-        // }
-        // end DEBUG
+      if (rcvHeaderSize > 0) {
+        // store the received ID, the body is received (and dropped) also if the header is not valid.
+        h = static_cast<F2EHeader*>(headerPart->GetData());
+        bool validHeader = (rcvHeaderSize == sizeof(F2EHeader) && h->version == F2EHeader::CurrentVersion);
+        if (validHeader) {
+          id = h->timeframeId;
+          fLastTimeframeId.store(id, memory_order_relaxed);
+        }
+        // LOG(INFO) << "Received sub-time frame #" << id << " from FLP" << h->flpIndex;
 
         FairMQMessage* dataPart = fTransportFactory->CreateMessage();
         rcvDataSize = dataInputChannel.Receive(dataPart);
 
-        if (fDiscardedSet.find(id) == fDiscardedSet.end()) {
-          // if received ID has not previously been discarded.
-          if (fTimeframeBuffer.find(id) == fTimeframeBuffer.end()) {
-            // if received ID is not yet in the buffer.
-            if (rcvDataSize > 0) {
-              // receive data, store it in the buffer, save the receive time.
-              fTimeframeBuffer[id].parts.push_back(dataPart);
-              fTimeframeBuffer[id].startTime = boost::posix_time::microsec_clock::local_time();
-            } else {
-              LOG(ERROR) << "no data received from input socket";
-              delete dataPart;
-            }
-            // PrintBuffer(fTimeframeBuffer);
-          } else {
-            // if received ID is already in the buffer
-            if (rcvDataSize > 0) {
-              fTimeframeBuffer[id].parts.push_back(dataPart);
-            } else {
-              LOG(ERROR) << "no data received from input socket";
-              delete dataPart;
-            }
-            // PrintBuffer(fTimeframeBuffer);
-          }
-        } else {
-          // if received ID has been previously discarded.
-          LOG(WARN) << "Received part from an already discarded timeframe with id " << id;
-          delete dataPart;
+        if (rcvDataSize > 0 && fSharedMemory) {
+          // replace the descriptor by the data it refers to, the reference comes with the descriptor.
+          rcvDataSize = fSharedMemory->Attach(dataPart) ? dataPart->GetSize() : -1;
         }
 
-        if (fTimeframeBuffer[id].parts.size() == fNumFLPs) {
-          // LOG(INFO) << "Collected all parts for timeframe #" << id;
-          // when all parts are collected send all except last one with 'snd-more' flag, and last one without the flag.
-          for (int i = 0; i < fNumFLPs - 1; ++i) {
-            dataOutChannel.Send(fTimeframeBuffer[id].parts.at(i), SNDMORE);
-          }
-          dataOutChannel.Send(fTimeframeBuffer[id].parts.at(fNumFLPs - 1));
-
-          if (fTestMode > 0) {
-            // Send an acknowledgement back to the sampler to measure the round trip time
-            FairMQMessage* ack = fTransportFactory->CreateMessage(sizeof(uint16_t));
-            memcpy(ack->GetData(), &id, sizeof(uint16_t));
+        if (rcvDataSize > 0 && validHeader) {
+          RecordArrival(h->flpIndex, rcvDataSize, now);
+        }
 
-            if (ackOutChannel.Send(ack, NOBLOCK) <= 0) {
-              LOG(ERROR) << "Could not send acknowledgement without blocking";
-            }
+        bool decoded = true;
+        if (rcvDataSize > 0 && validHeader && h->codec != CodecNone) {
+          decoded = DecompressPart(h->codec, dataPart);
+        }
 
-            delete ack;
+        if (rcvDataSize <= 0) {
+          LOG(ERROR) << "no data received from input socket";
+          delete dataPart;
+        } else if (!decoded) {
+          LOG(ERROR) << "Could not decompress part of timeframe #" << id << " from FLP " << h->flpIndex << " (codec "
+                     << Codec::Name(h->codec) << "), discarding it";
+          delete dataPart;
+        } else if (!validHeader) {
+          LOG(ERROR) << "Received sub-timeframe header of " << rcvHeaderSize << " bytes and version "
+                     << (rcvHeaderSize >= static_cast<int>(sizeof(uint16_t)) ? h->version : 0) << ", expected "
+                     << sizeof(F2EHeader) << " bytes and version " << F2EHeader::CurrentVersion << ", discarding it";
+          delete dataPart;
+        } else if (h->flpIndex >= fNumFLPs) {
+          LOG(ERROR) << "Received part of timeframe #" << id << " with invalid FLP index " << h->flpIndex << ", discarding it";
+          delete dataPart;
+        } else if (fTimeframeBuffer.IsPast(id)) {
+          // the timeframe has left the buffer, the part must not open its slot again.
+          if (fDiscardedSet.find(id) == fDiscardedSet.end()) {
+            // repeated part of a completed timeframe (or of one too old to tell)
+            LOG(WARN) << "Received part of already completed timeframe #" << id << " from FLP " << h->flpIndex << ", discarding it";
+            fDuplicateParts->Add();
+            delete dataPart;
+          } else if (fForwardLateParts > 0) {
+            // late part: its timeframe was discarded or forwarded
+            ForwardLatePart(id, h->flpIndex, dataPart);
+          } else {
+            LOG(WARN) << "Received late part of timeframe #" << id << " from FLP " << h->flpIndex << ", discarding it";
+            fLatePartsRejected->Add();
+            delete dataPart;
           }
+        } else {
+          TFBuffer& tf = fTimeframeBuffer.Slot(id);
 
-          // let transport know that the data is no longer needed. transport will clean up after it is sent out.
-          for (int i = 0; i < fTimeframeBuffer[id].parts.size(); ++i) {
-            delete fTimeframeBuffer[id].parts.at(i);
+          if (tf.inUse && tf.id != id) {
+            // slot is still occupied by an older incomplete timeframe, the window is exhausted.
+            LOG(WARN) << "Timeframe #" << tf.id << " still incomplete when #" << id << " arrived (buffer window "
+                      << fTimeframeBuffer.Window() << ")";
+            ExpireTimeframe(tf);
           }
-          fTimeframeBuffer[id].parts.clear();
 
-          // fTimeframeBuffer[id].endTime = boost::posix_time::microsec_clock::local_time();
-          // do something with time here ...
-          fTimeframeBuffer.erase(id);
+          if (!tf.inUse) {
+            // if received ID is not yet in the buffer, save the receive time.
+            fTimeframeBuffer.Open(tf, id, now);
+          }
+          // PrintBuffer(fTimeframeBuffer);
+
+          TimeframeBuilder::AddResult result = fTimeframeBuffer.Add(tf, h->flpIndex, dataPart);
+
+          if (result == TimeframeBuilder::DuplicatePart) {
+            LOG(WARN) << "Received duplicate part of timeframe #" << id << " from FLP " << h->flpIndex << ", discarding it";
+            fDuplicateParts->Add();
+            delete dataPart;
+          } else if (result == TimeframeBuilder::TimeframeComplete) {
+            // LOG(INFO) << "Collected all parts for timeframe #" << id;
+            fTimeframesBuilt->Add();
+            fBuildTime->Record(chrono::duration_cast<chrono::microseconds>(now - tf.startTime).count());
+
+            if (fDispatchQueueSize > 0) {
+              // hand the parts over to the dispatch thread, the slot keeps an empty part container.
+              fTimeframeBuffer.Release(tf, !QueueTimeframe(id, nullptr, tf.parts));
+            } else {
+              // parts are handed over to the transport, the slot keeps its empty part container.
+              SendTimeframe(id, nullptr, tf.parts, dataOutChannel, ackOutChannel);
+              fTimeframeBuffer.Release(tf, false);
+            }
+          }
         }
 
-        // LOG(WARN) << "Buffer size: " << fTimeframeBuffer.size();
+        // LOG(WARN) << "Buffer size: " << fTimeframeBuffer.Size();
       }
       delete headerPart;
     }
 
     // check if any incomplete timeframes in the buffer are older than timeout period, and discard them if they are
-    DiscardIncompleteTimeframes();
-  }
-
-  // DEBUG: save
-  // if (fTestMode > 0) {
-  //   string name = to_iso_string(boost::posix_time::microsec_clock::local_time()).substr(0, 20);
-  //   for (int x = 0; x < fNumFLPs; ++x) {
-  //     ofstream flpRcvTimes(fId + "-" + name + "-flp-" + to_string(x) + ".log");
-  //     for (auto it = rcvIntervals.at(x).begin() ; it != rcvIntervals.at(x).end(); ++it) {
-  //       flpRcvTimes << *it << endl;
-  //     }
-  //     flpRcvTimes.close();
-  //   }
-  // }
-  // end DEBUG
-
-  // heartbeatSender.interrupt();
-  // heartbeatSender.join();
+    DiscardIncompleteTimeframes(now);
+
+    fBufferOccupancy->Set(fTimeframeBuffer.Size());
+    fDispatchOccupancy->Set(fDispatchQueue.Size());
+
+    if (fSendHeartbeats > 0) {
+      // credits: slots that can take a new timeframe, minus the complete ones still waiting for the output.
+      int freeSlots = fTimeframeBuffer.Window() - fTimeframeBuffer.Size() - static_cast<int>(fDispatchQueue.Size());
+      fFreeSlots.store(freeSlots > 0 ? freeSlots : 0, memory_order_relaxed);
+    }
+
+    if (fDispatchQueueSize > 0 && now - lastQueueReport > chrono::seconds(10)) {
+      LOG(INFO) << "Dispatch queue occupancy: " << fDispatchQueue.Size() << " (max " << fDispatchQueueMax
+                << ") of " << fDispatchQueue.Capacity() << ", found full " << fDispatchQueueFull << " times";
+      fDispatchQueueMax = 0;
+      lastQueueReport = now;
+    }
+  }
+
+  if (fDispatchQueueSize > 0) {
+    dispatcher.interrupt();
+    dispatcher.join();
+
+    // delete the timeframes that have not been dispatched
+    while (CompletedTimeframe* entry = fDispatchQueue.Front()) {
+      delete entry->header;
+      entry->header = nullptr;
+      for (auto& part : entry->parts) {
+        delete part;
+        part = nullptr;
+      }
+      fDispatchQueue.Pop();
+    }
+  }
+
+  if (fSendHeartbeats > 0) {
+    heartbeatSender.interrupt();
+    heartbeatSender.join();
+  }
+  if (receivingIds) {
+    idReceiver.interrupt();
+    idReceiver.join();
+  }
+
+  fMetrics.StopPublishing();
+}
+
+bool EPNReceiver::DecompressPart(int codec, FairMQMessage* dataPart)
+{
+  const char* input = static_cast<const char*>(dataPart->GetData());
+  size_t size = dataPart->GetSize();
+  uint64_t rawSize = Codec::RawSize(input, size);
+
+  // no codec expands its input more than 256 times, a larger size comes from a corrupt frame.
+  if (rawSize == 0 || rawSize > static_cast<uint64_t>(size) * 256) {
+    return false;
+  }
+
+  char* output = new char[rawSize];
+  if (!Codec::Decompress(codec, input, size, output)) {
+    delete[] output;
+    return false;
+  }
+
+  dataPart->Rebuild(output, rawSize, &Codec::FreeBuffer, nullptr);
+  fBytesDecompressed->Add(rawSize);
+
+  return true;
+}
+
+CompletedTimeframe* EPNReceiver::NextDispatchEntry()
+{
+  CompletedTimeframe* entry = fDispatchQueue.Back();
+
+  if (!entry) {
+    // dispatch thread does not keep up, wait for it (input is not drained meanwhile).
+    ++fDispatchQueueFull;
+    while (!(entry = fDispatchQueue.Back())) {
+      if (!CheckCurrentState(RUNNING)) {
+        return nullptr;
+      }
+      boost::this_thread::sleep(boost::posix_time::microseconds(100));
+    }
+  }
+
+  return entry;
+}
+
+bool EPNReceiver::QueueTimeframe(uint64_t id, FairMQMessage* header, vector<FairMQMessage*>& parts)
+{
+  CompletedTimeframe* entry = NextDispatchEntry();
+
+  if (!entry) {
+    delete header;
+    return false;
+  }
+
+  entry->id = id;
+  entry->header = header;
+  entry->parts.swap(parts);
+  fDispatchQueue.Push();
+
+  size_t occupancy = fDispatchQueue.Size();
+  if (occupancy > fDispatchQueueMax) {
+    fDispatchQueueMax = occupancy;
+  }
+
+  return true;
+}
+
+void EPNReceiver::Dispatch()
+{
+  FairMQChannel& dataOutChannel = fChannels.at("data-out").at(0);
+  FairMQChannel* ackOutChannel = (fTestMode > 0) ? &(fChannels.at("ack-out").at(0)) : nullptr;
+
+  int idleCount = 0;
+
+  while (CheckCurrentState(RUNNING)) {
+    try {
+      CompletedTimeframe* entry = fDispatchQueue.Front();
+
+      if (!entry) {
+        // spin for a while before backing off, to keep the latency low under load.
+        if (++idleCount < 1000) {
+          boost::this_thread::yield();
+        } else {
+          boost::this_thread::sleep(boost::posix_time::microseconds(100));
+        }
+        continue;
+      }
+
+      idleCount = 0;
+
+      SendTimeframe(entry->id, entry->header, entry->parts, dataOutChannel, ackOutChannel);
+      entry->header = nullptr;
+      fDispatchQueue.Pop();
+    } catch (boost::thread_interrupted&) {
+      LOG(INFO) << "EPNReceiver::Dispatch() interrupted";
+      break;
+    }
+  }
+}
+
+void EPNReceiver::SendTimeframe(uint64_t id, FairMQMessage* header, vector<FairMQMessage*>& parts, FairMQChannel& dataOutChannel, FairMQChannel* ackOutChannel)
+{
+  if (header) {
+    // fragments are preceded by their header (there is always at least one part).
+    dataOutChannel.Send(header, fSndMoreFlag);
+    delete header;
+  }
+
+  // send all parts with one call, ordered by the FLP index. transport cleans up after they are sent out.
+  int64_t bytesSent = SendParts(dataOutChannel, parts, fSndMoreFlag);
+  if (bytesSent < 0) {
+    LOG(ERROR) << "Could not send timeframe #" << id;
+  } else {
+    fTimeframesSent->Add();
+    fBytesOut->Add(bytesSent);
+  }
+
+  // only complete timeframes are acknowledged.
+  if (ackOutChannel && !header) {
+    // Send an acknowledgement back to the sampler to measure the round trip time
+    FairMQMessage* ack = fTransportFactory->CreateMessage(sizeof(uint64_t));
+    memcpy(ack->GetData(), &id, sizeof(uint64_t));
+
+    if (ackOutChannel->Send(ack, fNoBlockFlag) <= 0) {
+      LOG(ERROR) << "Could not send acknowledgement without blocking";
+    }
+
+    delete ack;
+  }
 }
 
 void EPNReceiver::sendHeartbeats()
@@ -217,11 +625,21 @@ void EPNReceiver::sendHeartbeats()
   string ownAddress = fChannels.at("data-in").at(0).GetAddress();
   size_t ownAddressSize = strlen(ownAddress.c_str());
 
+  EPNHeartbeat hb;
+  hb.reserved = 0;
+
   while (CheckCurrentState(RUNNING)) {
     try {
+      // advertise the free slots, valid from a timeframe the flpSenders have not reached yet. The published ID
+      // advances also while this epnReceiver gets no timeframes (e.g. without credits), the received one does not.
+      hb.validFromId = max(fLastTimeframeId.load(memory_order_relaxed), fPublishedTimeframeId.load(memory_order_relaxed))
+                       + fCreditLead;
+      hb.credits = fFreeSlots.load(memory_order_relaxed);
+
       for (int i = 0; i < fNumFLPs; ++i) {
-        FairMQMessage* heartbeatMsg = fTransportFactory->CreateMessage(ownAddressSize);
-        memcpy(heartbeatMsg->GetData(), ownAddress.c_str(), ownAddressSize);
+        FairMQMessage* heartbeatMsg = fTransportFactory->CreateMessage(sizeof(EPNHeartbeat) + ownAddressSize);
+        memcpy(heartbeatMsg->GetData(), &hb, sizeof(EPNHeartbeat));
+        memcpy(static_cast<char*>(heartbeatMsg->GetData()) + sizeof(EPNHeartbeat), ownAddress.c_str(), ownAddressSize);
 
         fChannels.at("heartbeat-out").at(i).Send(heartbeatMsg);
 
@@ -235,9 +653,49 @@ void EPNReceiver::sendHeartbeats()
   }
 }
 
+void EPNReceiver::receiveTimeframeIds()
+{
+  FairMQChannel& idChannel = fChannels.at("id-in").at(0);
+  FairMQPoller* poller = fTransportFactory->CreatePoller(fChannels.at("id-in"));
+  FairMQMessage* msg = fTransportFactory->CreateMessage();
+
+  while (CheckCurrentState(RUNNING)) {
+    try {
+      boost::this_thread::interruption_point();
+
+      poller->Poll(100);
+      if (!poller->CheckInput(0) || idChannel.Receive(msg) != static_cast<int>(sizeof(uint64_t))) {
+        continue;
+      }
+
+      uint64_t id;
+      memcpy(&id, msg->GetData(), sizeof(uint64_t));
+      fPublishedTimeframeId.store(id, memory_order_relaxed);
+    } catch (boost::thread_interrupted&) {
+      LOG(INFO) << "EPNReceiver::receiveTimeframeIds() interrupted";
+      break;
+    }
+  }
+
+  delete msg;
+  delete poller;
+}
+
 void EPNReceiver::SetProperty(const int key, const string& value)
 {
   switch (key) {
+    case IncompletePolicy:
+      fIncompletePolicyName = value;
+      break;
+    case MetricsFile:
+      fMetricsFile = value;
+      break;
+    case DataInTransport:
+      fDataInTransport = value;
+      break;
+    case ShmSegmentName:
+      fShmSegmentName = value;
+      break;
     default:
       FairMQDevice::SetProperty(key, value);
       break;
@@ -247,6 +705,14 @@ void EPNReceiver::SetProperty(const int key, const string& value)
 string EPNReceiver::GetProperty(const int key, const string& default_/*= ""*/)
 {
   switch (key) {
+    case IncompletePolicy:
+      return fIncompletePolicyName;
+    case MetricsFile:
+      return fMetricsFile;
+    case DataInTransport:
+      return fDataInTransport;
+    case ShmSegmentName:
+      return fShmSegmentName;
     default:
       return FairMQDevice::GetProperty(key, default_);
   }
@@ -258,6 +724,27 @@ void EPNReceiver::SetProperty(const int key, const int value)
     case HeartbeatIntervalInMs:
       fHeartbeatIntervalInMs = value;
       break;
+    case BufferWindow:
+      fBufferWindow = value;
+      break;
+    case DispatchQueueSize:
+      fDispatchQueueSize = value;
+      break;
+    case SendHeartbeats:
+      fSendHeartbeats = value;
+      break;
+    case CreditLead:
+      fCreditLead = value;
+      break;
+    case ForwardLateParts:
+      fForwardLateParts = value;
+      break;
+    case MetricsIntervalInMs:
+      fMetricsIntervalInMs = value;
+      break;
+    case ShmSegmentSize:
+      fShmSegmentSize = value;
+      break;
     case BufferTimeoutInMs:
       fBufferTimeoutInMs = value;
       break;
@@ -278,6 +765,20 @@ int EPNReceiver::GetProperty(const int key, const int default_/*= 0*/)
   switch (key) {
     case HeartbeatIntervalInMs:
       return fHeartbeatIntervalInMs;
+    case BufferWindow:
+      return fBufferWindow;
+    case DispatchQueueSize:
+      return fDispatchQueueSize;
+    case SendHeartbeats:
+      return fSendHeartbeats;
+    case CreditLead:
+      return fCreditLead;
+    case ForwardLateParts:
+      return fForwardLateParts;
+    case MetricsIntervalInMs:
+      return fMetricsIntervalInMs;
+    case ShmSegmentSize:
+      return fShmSegmentSize;
     case BufferTimeoutInMs:
       return fBufferTimeoutInMs;
     case NumFLPs:
@@ -9,26 +9,34 @@
 #define ALICEO2_DEVICES_EPNRECEIVER_H_
 
 #include <string>
-#include <unordered_map>
+#include <queue>
+#include <atomic>
+#include <chrono>
 #include <unordered_set>
-
-#include <boost/date_time/posix_time/posix_time.hpp>
+#include <memory>
 
 #include "FairMQDevice.h"
 
+#include "TimeframeBuilder.h"
+#include "SPSCQueue.h"
+#include "DeviceMetrics.h"
+#include "SharedMemorySegment.h"
+
 namespace AliceO2 {
 namespace Devices {
 
-/// Container for (sub-)timeframes
+/// Completed timeframe, handed from the receive thread to the dispatch thread
 
-struct TFBuffer
+struct CompletedTimeframe
 {
-  std::vector<FairMQMessage*> parts;
-  boost::posix_time::ptime startTime;
-  boost::posix_time::ptime endTime;
+  uint64_t id; ///< Timeframe ID
+  FairMQMessage* header; ///< Fragment header of an incomplete timeframe or a late part, nullptr for complete timeframes
+  std::vector<FairMQMessage*> parts; ///< Parts ordered by flpIndex, preallocated to the number of flpSenders
 };
 
 /// Receives sub-timeframes from the flpSenders and merges these into full timeframes.
+///
+/// Timeframes still incomplete after the buffer timeout are handled according to the incomplete policy.
 
 class EPNReceiver : public FairMQDevice
 {
@@ -39,9 +47,26 @@ class EPNReceiver : public FairMQDevice
       BufferTimeoutInMs, ///< Time after which incomplete timeframes are dropped
       TestMode, ///< Run the device in test mode
       HeartbeatIntervalInMs, ///< Interval for sending heartbeats
+      BufferWindow, ///< Number of slots in the timeframe buffer
+      DispatchQueueSize, ///< Depth of the lock-free queue to the dispatch thread, which owns data-out and ack-out (0 - receive and dispatch in one thread)
+      SendHeartbeats, ///< Send heartbeats with buffer credits to the flpSenders (1/0)
+      CreditLead, ///< Number of timeframe IDs ahead of the current one (last published on id-in, or else last received) from which advertised credits apply
+      IncompletePolicy, ///< Handling of timeframes incomplete after the buffer timeout: "discard" or "forward"
+      ForwardLateParts, ///< Forward parts arriving after their timeframe was discarded or forwarded (1/0)
+      MetricsFile, ///< File the metrics are appended to (empty - none), they are also published on the optional metrics-out channel
+      MetricsIntervalInMs, ///< Interval for publishing the metrics
+      DataInTransport, ///< Transport of the data-in channel: "zmq" or "shm" (parts reference the SharedMemorySegment)
+      ShmSegmentName, ///< Name of the shared memory segment
+      ShmSegmentSize, ///< Size of the shared memory segment in MB (if it is created)
       Last
     };
 
+    /// Handling of timeframes that are incomplete after the buffer timeout
+    enum IncompletePolicies {
+      IncompleteDiscard, ///< drop the received parts
+      IncompleteForward ///< send the received parts with a header listing the missing flpSenders
+    };
+
     /// Default constructor
     EPNReceiver();
 
@@ -49,9 +74,22 @@ class EPNReceiver : public FairMQDevice
     virtual ~EPNReceiver();
 
     /// Prints the contents of the timeframe container
-    void PrintBuffer(const std::unordered_map<uint16_t, TFBuffer>& buffer) const;
-    /// Discared incomplete timeframes after \p fBufferTimeoutInMs.
-    void DiscardIncompleteTimeframes();
+    void PrintBuffer(const TimeframeBuilder& buffer) const;
+    /// Discared (or forwards) incomplete timeframes after \p fBufferTimeoutInMs.
+    /// @param now  Current time (monotonic), read once per loop iteration
+    void DiscardIncompleteTimeframes(const std::chrono::steady_clock::time_point& now);
+    /// Removes an incomplete timeframe from the buffer according to the incomplete policy
+    /// and remembers its ID to recognize its late parts
+    void ExpireTimeframe(TFBuffer& tf);
+    /// Drops a buffered timeframe
+    void DiscardTimeframe(TFBuffer& tf);
+    /// Sends a buffered incomplete timeframe with a fragment header
+    void ForwardTimeframe(TFBuffer& tf);
+    /// Sends a part that arrived after its timeframe left the buffer as a single fragment
+    /// @param id       Timeframe ID
+    /// @param flpIndex Index of the flpSender
+    /// @param dataPart Sub-timeframe body, ownership is taken
+    void ForwardLatePart(uint64_t id, int flpIndex, FairMQMessage* dataPart);
 
     /// Set device properties stored as strings
     /// @param key      Property key
@@ -72,19 +110,110 @@ class EPNReceiver : public FairMQDevice
     /// @return         Property value
     virtual int GetProperty(const int key, const int default_ = 0);
 
+    /// Number of incomplete timeframes discarded so far (to be read when the device is not running)
+    unsigned long NumDiscarded() const { return fNumDiscarded; }
+
   protected:
+    /// Overloads the InitTask() method of FairMQDevice
+    virtual void InitTask();
     /// Overloads the Run() method of FairMQDevice
     virtual void Run();
     /// Sends heartbeats to flpSenders
     void sendHeartbeats();
-
-    std::unordered_map<uint16_t, TFBuffer> fTimeframeBuffer; ///< Stores (sub-)timeframes
-    std::unordered_set<uint16_t> fDiscardedSet; ///< Set containing IDs of dropped timeframes
+    /// Receives the timeframe IDs published by the flpSyncSampler on the optional id-in channel
+    void receiveTimeframeIds();
+    /// Sends out completed timeframes from the dispatch queue (dispatch thread)
+    void Dispatch();
+    /// Sends a timeframe as one multipart message and, in test mode, the acknowledgement of a complete timeframe
+    /// @param id               Timeframe ID
+    /// @param header           Fragment header (nullptr for a complete timeframe), ownership is taken
+    /// @param parts            Parts of the timeframe, ordered by flpIndex (missing ones nullptr). Ownership is passed
+    ///                         to the transport, the entries are reset to nullptr.
+    /// @param dataOutChannel   Output channel for the timeframe
+    /// @param ackOutChannel    Output channel for the acknowledgement (nullptr if none)
+    void SendTimeframe(uint64_t id, FairMQMessage* header, std::vector<FairMQMessage*>& parts, FairMQChannel& dataOutChannel, FairMQChannel* ackOutChannel);
+    /// Returns the next free entry of the dispatch queue, waits if the queue is full
+    /// @return nullptr if the device stopped running before there was space in the queue
+    CompletedTimeframe* NextDispatchEntry();
+    /// Moves the parts of a timeframe to the dispatch queue, waits if the queue is full
+    /// @param id       Timeframe ID
+    /// @param header   Fragment header (nullptr for a complete timeframe), ownership is taken
+    /// @param parts    Parts of the timeframe, swapped with the empty container of the queue entry
+    /// @return false if the device stopped running before there was space in the queue (parts stay in \p parts)
+    bool QueueTimeframe(uint64_t id, FairMQMessage* header, std::vector<FairMQMessage*>& parts);
+    /// Creates the fragment header message
+    /// @param id       Timeframe ID
+    /// @param type     TimeframeFragmentHeader::Types
+    /// @param flpIndex Index of the flpSender of a late fragment
+    /// @param tf       Incomplete timeframe whose missing parts are listed (nullptr for a late fragment)
+    FairMQMessage* CreateFragmentHeader(uint64_t id, uint16_t type, int flpIndex, const TFBuffer* tf);
+    /// Registers the metrics of the device
+    void InitMetrics();
+    /// Updates the input metrics for a received part
+    /// @param flpIndex Index of the flpSender (ignored for the per-flpSender metrics if out of range)
+    /// @param size     Size of the part in bytes
+    /// @param now      Arrival time
+    void RecordArrival(int flpIndex, int size, const std::chrono::steady_clock::time_point& now);
+    /// Replaces a compressed sub-timeframe body by its decompressed data
+    /// @param codec    Codec ID from the header
+    /// @param dataPart Sub-timeframe body
+    /// @return         false if the codec is unknown or the data is corrupt (the body is unchanged)
+    bool DecompressPart(int codec, FairMQMessage* dataPart);
+
+    TimeframeBuilder fTimeframeBuffer; ///< Stores (sub-)timeframes
+    std::unordered_set<uint64_t> fDiscardedSet; ///< Set containing IDs of recently dropped or forwarded incomplete timeframes
+    std::queue<uint64_t> fDiscardedQueue; ///< IDs of dropped timeframes in order of discarding, bounds fDiscardedSet to fBufferWindow entries
+    unsigned long fNumDiscarded; ///< Total number of dropped timeframes
+    std::string fIncompletePolicyName; ///< Handling of timeframes incomplete after the buffer timeout: "discard" or "forward"
+    int fIncompletePolicy; ///< Handling of timeframes incomplete after the buffer timeout, see IncompletePolicies
+    int fForwardLateParts; ///< Forward parts arriving after their timeframe was discarded or forwarded (1/0)
+    unsigned long fNumForwarded; ///< Total number of forwarded incomplete timeframes
+    unsigned long fNumLateForwarded; ///< Total number of forwarded late parts
 
     int fNumFLPs; ///< Number of flpSenders
     int fBufferTimeoutInMs; ///< Time after which incomplete timeframes are dropped
     int fTestMode; ///< Run the device in test mode (only syncSampler+flpSender+epnReceiver)
     int fHeartbeatIntervalInMs; ///< Interval for sending heartbeats
+    int fBufferWindow; ///< Number of slots in the timeframe buffer
+
+    int fSndMoreFlag; ///< Flag for faster access to multipart sending
+    int fNoBlockFlag; ///< Flag for faster access to sending without blocking
+
+    int fDispatchQueueSize; ///< Depth of the queue to the dispatch thread (0 - receive and dispatch in one thread)
+    SPSCQueue<CompletedTimeframe> fDispatchQueue; ///< Completed timeframes waiting for the dispatch thread
+    size_t fDispatchQueueMax; ///< Highest occupancy of the dispatch queue since the last report
+    unsigned long fDispatchQueueFull; ///< Number of times the receive thread found the dispatch queue full
+
+    int fSendHeartbeats; ///< Send heartbeats with buffer credits to the flpSenders (1/0)
+    int fCreditLead; ///< Number of timeframe IDs ahead of the current one from which advertised credits apply
+    std::atomic<int> fFreeSlots; ///< Free timeframe slots (credits), updated by the receive thread
+    std::atomic<uint64_t> fLastTimeframeId; ///< ID of the last received sub-timeframe, updated by the receive thread
+    std::atomic<uint64_t> fPublishedTimeframeId; ///< Last timeframe ID published by the flpSyncSampler (id-in channel, 0 - none)
+
+    DeviceMetrics fMetrics; ///< Device metrics, published by their own thread
+    std::string fMetricsFile; ///< File the metrics are appended to (empty - none)
+    int fMetricsIntervalInMs; ///< Interval for publishing the metrics
+    DeviceMetrics::Counter* fPartsIn; ///< Received sub-timeframes
+    DeviceMetrics::Counter* fBytesIn; ///< Received sub-timeframe bytes (bodies)
+    DeviceMetrics::Counter* fTimeframesBuilt; ///< Completed timeframes
+    DeviceMetrics::Counter* fTimeframesDiscarded; ///< Incomplete timeframes dropped
+    DeviceMetrics::Counter* fTimeframesForwarded; ///< Incomplete timeframes forwarded
+    DeviceMetrics::Counter* fLatePartsForwarded; ///< Late parts forwarded
+    DeviceMetrics::Counter* fLatePartsRejected; ///< Late parts dropped
+    DeviceMetrics::Counter* fDuplicateParts; ///< Duplicate parts dropped
+    DeviceMetrics::Counter* fTimeframesSent; ///< Timeframes and fragments handed to the output transport
+    DeviceMetrics::Counter* fBytesOut; ///< Bytes handed to the output transport (without fragment headers)
+    DeviceMetrics::Gauge* fBufferOccupancy; ///< Timeframes in the buffer
+    DeviceMetrics::Gauge* fDispatchOccupancy; ///< Timeframes in the dispatch queue
+    DeviceMetrics::Histogram* fBuildTime; ///< Time from the first to the last part of complete timeframes, in microseconds
+    DeviceMetrics::Counter* fBytesDecompressed; ///< Size of the decompressed sub-timeframe bodies
+    std::vector<DeviceMetrics::Histogram*> fInterArrival; ///< Time between two parts from the same flpSender, in microseconds
+    std::vector<std::chrono::steady_clock::time_point> fLastArrival; ///< Arrival time of the last part per flpSender (receive thread)
+
+    std::string fDataInTransport; ///< Transport of the data-in channel: "zmq" or "shm"
+    std::string fShmSegmentName; ///< Name of the shared memory segment
+    int fShmSegmentSize; ///< Size of the shared memory segment in MB (if it is created)
+    std::unique_ptr<SharedMemorySegment> fSharedMemory; ///< Segment for the shm data-in channel (nullptr with zmq)
 };
 
 } // namespace Devices
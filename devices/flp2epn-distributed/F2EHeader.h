@@ -0,0 +1,36 @@
+/**
+ * F2EHeader.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef ALICEO2_DEVICES_F2EHEADER_H_
+#define ALICEO2_DEVICES_F2EHEADER_H_
+
+#include <cstdint>
+
+namespace AliceO2 {
+namespace Devices {
+
+/// Header of a sub-timeframe, sent by the flpSenders in front of the sub-timeframe body
+///
+/// Timeframe IDs are 64-bit and do not wrap around, so an ID identifies a timeframe for the whole run
+/// regardless of rate and buffering time. epnReceivers drop sub-timeframes whose header size or version
+/// they do not know. The codec field was padding before, which old flpSenders set to 0 (CodecNone).
+
+struct F2EHeader
+{
+  static const uint16_t CurrentVersion = 1; ///< Version written by this code
+
+  uint16_t version; ///< Header version, CurrentVersion
+  uint16_t flpIndex; ///< Index of the flpSender
+  uint16_t codec; ///< Codec of the sub-timeframe body, see Codecs
+  uint16_t reserved; ///< Padding, set to 0
+  uint64_t timeframeId; ///< Timeframe ID
+};
+
+} // namespace Devices
+} // namespace AliceO2
+
+#endif
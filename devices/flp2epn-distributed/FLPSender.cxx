@@ -7,6 +7,10 @@
 
 #include <cstdint> // UINT64_MAX
 #include <cassert>
+#include <cstring> // memcpy
+#include <chrono>
+#include <sstream>
+#include <algorithm> // find
 
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
@@ -14,34 +18,82 @@
 #include "FairMQLogger.h"
 #include "FairMQMessage.h"
 #include "FairMQTransportFactory.h"
+#include "FairMQPoller.h"
 
 #include "FLPSender.h"
+#include "EPNHeartbeat.h"
+#include "MembershipUpdate.h"
+#include "F2EHeader.h"
+#include "Codec.h"
 
 using namespace std;
-using boost::posix_time::ptime;
 
 using namespace AliceO2::Devices;
 
-struct f2eHeader {
-  uint16_t timeFrameId;
-  int      flpIndex;
-};
-
 FLPSender::FLPSender()
-  : fIndex(0)
+  : fSendBuffer()
+  , fBufferSize(1000)
+  , fTokenBuckets()
+  , fSendRate(0)
+  , fSendBurst(0)
+  , fNumEPNs(0)
+  , fIndex(0)
   , fSendOffset(0)
   , fSendDelay(8)
-  , fHeaderBuffer()
-  , fDataBuffer()
-  , fArrivalTime()
   , fSndMoreFlag(0)
   , fNoBlockFlag(0)
-  , fNumEPNs(0)
-  , fHeartbeatTimeoutInMs(20000)
-  , fHeartbeats()
-  , fHeartbeatMutex()
   , fEventSize(10000)
   , fTestMode(0)
+  , fHeartbeatTimeoutInMs(20000)
+  , fHeartbeatTimeoutInNs(0)
+  , fLastHeartbeat()
+  , fEPNDead()
+  , fDeadEPNPolicyName("drop")
+  , fDeadEPNPolicy(DeadEPNPolicyDrop)
+  , fHoldLimit(100)
+  , fOutputQueues()
+  , fNumQueued(0)
+  , fOutputQueueSize(100)
+  , fOverflowPolicyName("block")
+  , fOverflowPolicy(OverflowBlock)
+  , fNumBlocked(0)
+  , fEPNSelection("round-robin")
+  , fCreditBased(false)
+  , fEPNIndex()
+  , fCreditScheduler()
+  , fCreditUpdates()
+  , fMembership()
+  , fMembershipUpdates()
+  , fMessagePool()
+  , fMetrics()
+  , fMetricsFile()
+  , fMetricsIntervalInMs(1000)
+  , fStfIn(nullptr)
+  , fBytesIn(nullptr)
+  , fStfSent(nullptr)
+  , fBytesOut(nullptr)
+  , fStfDropped(nullptr)
+  , fSendBufferOccupancy(nullptr)
+  , fOutputQueueOccupancy(nullptr)
+  , fInterArrival(nullptr)
+  , fReleaseDelay(nullptr)
+  , fShmFull(nullptr)
+  , fStfCompressed(nullptr)
+  , fBytesSaved(nullptr)
+  , fEPNMembers(nullptr)
+  , fMembershipLate(nullptr)
+  , fCreditsLate(nullptr)
+  , fDataOutTransport("zmq")
+  , fShmOut()
+  , fShmSegmentName("flp2epn")
+  , fShmSegmentSize(1024)
+  , fSharedMemory()
+  , fDataOutCodec("none")
+  , fCodecOut()
+  , fCodecElementSize(2)
+  , fCompressionThreads(2)
+  , fCompression()
+  , fJobPool()
 {
 }
 
@@ -49,40 +101,255 @@ FLPSender::~FLPSender()
 {
 }
 
-void FLPSender::InitTask()
+/// Test-mode payload buffer, shared by all sub-timeframe bodies instead of copying it for each of them
+
+struct SharedPayload
 {
-  ptime nullTime;
+  atomic<int> refCount; ///< Number of messages referencing the buffer, plus one held by Run()
+  char* data; ///< Payload
+};
 
+/// Called by the transport (possibly from its I/O thread) when a message referencing the shared payload is gone
+static void releaseSharedPayload(void* /*data*/, void* hint)
+{
+  SharedPayload* payload = static_cast<SharedPayload*>(hint);
+  if (payload->refCount.fetch_sub(1, memory_order_acq_rel) == 1) {
+    delete[] payload->data;
+    delete payload;
+  }
+}
+
+/// Current steady clock time in nanoseconds, used for the lock-free liveness table
+static inline int64_t steadyNow()
+{
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FLPSender::InitTask()
+{
   fNumEPNs = fChannels.at("data-out").size();
 
+  if (fIndex > UINT16_MAX) {
+    LOG(ERROR) << "FLP index " << fIndex << " does not fit into the sub-timeframe header (max " << UINT16_MAX << ")";
+  }
+
+  for (int i = 0; i < fNumEPNs; ++i) {
+    fEPNIndex[fChannels.at("data-out").at(i).GetAddress()] = i;
+  }
+
+  vector<atomic<int64_t>>(fNumEPNs).swap(fLastHeartbeat);
+  for (auto& lastHeartbeat : fLastHeartbeat) {
+    lastHeartbeat.store(0);
+  }
+  fEPNDead.assign(fNumEPNs, false);
+  fOutputQueues.assign(fNumEPNs, OutputQueue());
+  for (auto& queue : fOutputQueues) {
+    queue.headerSent = false;
+    queue.maxSize = 0;
+    queue.numDropped = 0;
+  }
+  fNumQueued = 0;
+  fNumBlocked = 0;
+  fSendBuffer.Resize(fBufferSize);
+  fTokenBuckets.assign(fNumEPNs, TokenBucket());
+  fHeartbeatTimeoutInNs = static_cast<int64_t>(fHeartbeatTimeoutInMs) * 1000000;
+
+  if (fDeadEPNPolicyName == "off") {
+    fDeadEPNPolicy = DeadEPNPolicyOff;
+  } else if (fDeadEPNPolicyName == "drop") {
+    fDeadEPNPolicy = DeadEPNPolicyDrop;
+  } else if (fDeadEPNPolicyName == "hold") {
+    fDeadEPNPolicy = DeadEPNPolicyHold;
+  } else if (fDeadEPNPolicyName == "reroute") {
+    fDeadEPNPolicy = DeadEPNPolicyReroute;
+  } else {
+    LOG(ERROR) << "Unknown dead EPN policy \"" << fDeadEPNPolicyName << "\", using drop";
+    fDeadEPNPolicy = DeadEPNPolicyDrop;
+  }
+
+  if (fOverflowPolicyName == "block") {
+    fOverflowPolicy = OverflowBlock;
+  } else if (fOverflowPolicyName == "drop-oldest") {
+    fOverflowPolicy = OverflowDropOldest;
+  } else if (fOverflowPolicyName == "drop-newest") {
+    fOverflowPolicy = OverflowDropNewest;
+  } else {
+    LOG(ERROR) << "Unknown overflow policy \"" << fOverflowPolicyName << "\", using block";
+    fOverflowPolicy = OverflowBlock;
+  }
+
+  if (fEPNSelection == "credit") {
+    fCreditBased = true;
+    fCreditScheduler.Init(fNumEPNs);
+    // a few advertisements per epnReceiver can be in flight before the sending thread picks them up,
+    // more wait in the heartbeat thread.
+    fCreditUpdates.Resize(fNumEPNs * 4);
+  } else if (fEPNSelection == "round-robin") {
+    fCreditBased = false;
+  } else {
+    LOG(ERROR) << "Unknown EPN selection \"" << fEPNSelection << "\", using round-robin";
+    fCreditBased = false;
+  }
+
+  fMembership.Init(fNumEPNs);
+  // updates are repeated by the publisher, only changes are passed on to the sending thread.
+  fMembershipUpdates.Resize(16);
+
+  initTransports();
+  initCodecs();
+  initMetrics();
+}
+
+void FLPSender::initTransports()
+{
+  vector<string> transports;
+  stringstream list(fDataOutTransport);
+  string transport;
+  while (getline(list, transport, ',')) {
+    transports.push_back(transport);
+  }
+
+  if (transports.size() == 1) {
+    transports.assign(fNumEPNs, transports.front());
+  } else if (transports.size() != static_cast<size_t>(fNumEPNs)) {
+    LOG(ERROR) << "Data-out transport \"" << fDataOutTransport << "\" does not match the " << fNumEPNs << " data-out channels, using zmq";
+    transports.assign(fNumEPNs, "zmq");
+  }
+
+  fShmOut.assign(fNumEPNs, false);
+  for (int i = 0; i < fNumEPNs; ++i) {
+    if (transports[i] == "shm") {
+      fShmOut[i] = true;
+    } else if (transports[i] != "zmq") {
+      LOG(ERROR) << "Unknown transport \"" << transports[i] << "\" for data-out channel " << i << ", using zmq";
+    }
+  }
+
+  bool useShm = false;
   for (int i = 0; i < fNumEPNs; ++i) {
-    fHeartbeats[fChannels.at("data-out").at(i).GetAddress()] = nullTime;
+    useShm = useShm || fShmOut[i];
+  }
+
+  if (useShm && (!fSharedMemory || fSharedMemory->Name() != fShmSegmentName)) {
+    fSharedMemory.reset(new SharedMemorySegment(fShmSegmentName, static_cast<size_t>(fShmSegmentSize) << 20));
+  }
+}
+
+void FLPSender::initCodecs()
+{
+  vector<string> codecs;
+  stringstream list(fDataOutCodec);
+  string codec;
+  while (getline(list, codec, ',')) {
+    codecs.push_back(codec);
+  }
+
+  if (codecs.size() == 1) {
+    codecs.assign(fNumEPNs, codecs.front());
+  } else if (codecs.size() != static_cast<size_t>(fNumEPNs)) {
+    LOG(ERROR) << "Data-out codec \"" << fDataOutCodec << "\" does not match the " << fNumEPNs << " data-out channels, using none";
+    codecs.assign(fNumEPNs, "none");
+  }
+
+  fCodecOut.assign(fNumEPNs, CodecNone);
+  for (int i = 0; i < fNumEPNs; ++i) {
+    int id = Codec::FromName(codecs[i]);
+    if (id < 0) {
+      LOG(ERROR) << "Unknown codec \"" << codecs[i] << "\" for data-out channel " << i << ", using none";
+    } else {
+      fCodecOut[i] = id;
+    }
   }
 }
 
+void FLPSender::initMetrics()
+{
+  fMetrics.Clear();
+
+  fStfIn = &fMetrics.AddCounter("stf_in");
+  fBytesIn = &fMetrics.AddCounter("bytes_in");
+  fStfSent = &fMetrics.AddCounter("stf_sent");
+  fBytesOut = &fMetrics.AddCounter("bytes_out");
+  fStfDropped = &fMetrics.AddCounter("stf_dropped");
+
+  fSendBufferOccupancy = &fMetrics.AddGauge("send_buffer_occupancy");
+  fOutputQueueOccupancy = &fMetrics.AddGauge("output_queue_occupancy");
+
+  // 10 us to ~10 s in 31 buckets, same bounds as in the epnReceiver.
+  vector<uint64_t> bounds = DeviceMetrics::ExponentialBounds(10, 1.6, 31);
+  fInterArrival = &fMetrics.AddHistogram("interarrival_us", bounds);
+  fReleaseDelay = &fMetrics.AddHistogram("release_delay_us", bounds);
+
+  fShmFull = &fMetrics.AddCounter("shm_full");
+  fStfCompressed = &fMetrics.AddCounter("stf_compressed");
+  fBytesSaved = &fMetrics.AddCounter("codec_bytes_saved");
+  fEPNMembers = &fMetrics.AddGauge("epn_members");
+  fEPNMembers->Set(fNumEPNs);
+  fMembershipLate = &fMetrics.AddCounter("membership_late");
+  fCreditsLate = &fMetrics.AddCounter("credits_late");
+}
+
 void FLPSender::receiveHeartbeats()
 {
   FairMQChannel& hbChannel = fChannels.at("heartbeat-in").at(0);
+  // poll with a timeout, so that the thread can finish also when no heartbeats arrive.
+  FairMQPoller* poller = fTransportFactory->CreatePoller(fChannels.at("heartbeat-in"));
+
+  // credit updates wait here while the queue to the sending thread is full, none may be lost, or the
+  // credit table of this flpSender would differ from the others for good.
+  deque<CreditScheduler::Update> creditBacklog;
+  // last advertisement per epnReceiver (credits -1 - none yet), heartbeats repeat it until it changes.
+  vector<EPNHeartbeat> lastCredits(fNumEPNs, EPNHeartbeat{0, -1, 0});
+  // the last heartbeat times start with the start time of Run(), not telling whether an epnReceiver was heard from.
+  vector<bool> heardFrom(fNumEPNs, false);
 
   while (CheckCurrentState(RUNNING)) {
     try {
+      boost::this_thread::interruption_point();
+
+      while (!creditBacklog.empty()) {
+        CreditScheduler::Update* update = fCreditUpdates.Back();
+        if (!update) {
+          break;
+        }
+        *update = creditBacklog.front();
+        fCreditUpdates.Push();
+        creditBacklog.pop_front();
+      }
+
+      poller->Poll(100);
+      if (!poller->CheckInput(0)) {
+        continue;
+      }
+
       FairMQMessage* hbMsg = fTransportFactory->CreateMessage();
 
-      if (hbChannel.Receive(hbMsg) > 0) {
-        string address = string(static_cast<char*>(hbMsg->GetData()), hbMsg->GetSize());
+      if (hbChannel.Receive(hbMsg) > static_cast<int>(sizeof(EPNHeartbeat))) {
+        EPNHeartbeat hb = *(static_cast<EPNHeartbeat*>(hbMsg->GetData()));
+        string address = string(static_cast<char*>(hbMsg->GetData()) + sizeof(EPNHeartbeat), hbMsg->GetSize() - sizeof(EPNHeartbeat));
 
-        if (fHeartbeats.find(address) != fHeartbeats.end()) {
-            ptime now = boost::posix_time::microsec_clock::local_time();
-            ptime storedHeartbeat = fHeartbeats[address];
+        auto epn = fEPNIndex.find(address);
 
-            if (to_simple_string(storedHeartbeat) != "not-a-date-time") {
-              // LOG(INFO) << address << " last seen " << (now - storedHeartbeat).total_milliseconds() << " ms ago.";
-            } else {
-              LOG(INFO) << "Received first heartbeat from " << address << " (" << now << ")";
+        if (epn != fEPNIndex.end()) {
+            int64_t now = steadyNow();
+
+            fLastHeartbeat[epn->second].store(now, memory_order_release);
+
+            if (!heardFrom[epn->second]) {
+              LOG(INFO) << "Received first heartbeat from " << address;
+              heardFrom[epn->second] = true;
             }
 
-            boost::unique_lock<boost::shared_mutex> uniqueLock(fHeartbeatMutex);
-            fHeartbeats[address] = now;
+            EPNHeartbeat& last = lastCredits[epn->second];
+            if (fCreditBased && (hb.validFromId != last.validFromId || hb.credits != last.credits)) {
+              CreditScheduler::Update update;
+              update.epnIndex = epn->second;
+              update.validFromId = hb.validFromId;
+              update.credits = hb.credits;
+              // passed on at the start of the next iteration.
+              creditBacklog.push_back(update);
+              last = hb;
+            }
         } else {
           LOG(ERROR) << "IP " << address << " unknown, not provided at execution time";
         }
@@ -94,134 +361,674 @@ void FLPSender::receiveHeartbeats()
       break;
     }
   }
+
+  delete poller;
+}
+
+void FLPSender::receiveMembership()
+{
+  FairMQChannel& membershipChannel = fChannels.at("membership-in").at(0);
+  FairMQPoller* poller = fTransportFactory->CreatePoller(fChannels.at("membership-in"));
+  FairMQMessage* msg = fTransportFactory->CreateMessage();
+
+  // last update passed on, to skip its repetitions.
+  string lastUpdate;
+
+  while (CheckCurrentState(RUNNING)) {
+    try {
+      boost::this_thread::interruption_point();
+
+      poller->Poll(100);
+      if (!poller->CheckInput(0) || membershipChannel.Receive(msg) < static_cast<int>(sizeof(MembershipUpdate))) {
+        continue;
+      }
+
+      string update(static_cast<char*>(msg->GetData()), msg->GetSize());
+      if (update == lastUpdate) {
+        continue;
+      }
+
+      MembershipUpdate header;
+      memcpy(&header, update.data(), sizeof(MembershipUpdate));
+
+      // members are matched by address, so the selection order does not depend on the order of the data-out channels.
+      vector<int> members;
+      vector<bool> seen(fNumEPNs, false);
+      bool valid = true;
+      stringstream list(update.substr(sizeof(MembershipUpdate)));
+      string address;
+      while (getline(list, address, '\n')) {
+        auto epn = fEPNIndex.find(address);
+        if (epn == fEPNIndex.end() || seen[epn->second]) {
+          LOG(ERROR) << "Membership update with unknown or repeated EPN " << address << ", ignoring it";
+          valid = false;
+          break;
+        }
+        seen[epn->second] = true;
+        members.push_back(epn->second);
+      }
+
+      if (valid && (members.empty() || members.size() != header.numEPNs)) {
+        LOG(ERROR) << "Membership update with " << members.size() << " of " << header.numEPNs << " EPNs, ignoring it";
+        valid = false;
+      }
+
+      if (valid) {
+        MembershipTable::Update* next = fMembershipUpdates.Back();
+        if (!next) {
+          // not remembered as passed on, so a repetition is tried again.
+          LOG(WARN) << "Membership update queue full, postponing the update for timeframe #" << header.validFromId;
+          continue;
+        }
+        next->validFromId = header.validFromId;
+        next->members.swap(members);
+        fMembershipUpdates.Push();
+        LOG(INFO) << "Received membership update: " << header.numEPNs << " EPNs from timeframe #" << header.validFromId;
+      }
+
+      lastUpdate.swap(update);
+    } catch (boost::thread_interrupted&) {
+      LOG(INFO) << "FLPSender::receiveMembership() interrupted";
+      break;
+    }
+  }
+
+  delete msg;
+  delete poller;
 }
 
 void FLPSender::Run()
 {
-  // boost::thread heartbeatReceiver(boost::bind(&FLPSender::receiveHeartbeats, this));
+  // epnReceivers get one heartbeat timeout from the start to send their first heartbeat.
+  int64_t startTime = steadyNow();
+  for (auto& lastHeartbeat : fLastHeartbeat) {
+    lastHeartbeat.store(startTime, memory_order_release);
+  }
 
-  // base buffer, to be copied from for every timeframe body
-  void* buffer = operator new[](fEventSize);
-  FairMQMessage* baseMsg = fTransportFactory->CreateMessage(buffer, fEventSize);
+  bool receivingHeartbeats = fCreditBased || fDeadEPNPolicy != DeadEPNPolicyOff;
+  boost::thread heartbeatReceiver;
+  if (receivingHeartbeats) {
+    heartbeatReceiver = boost::thread(boost::bind(&FLPSender::receiveHeartbeats, this));
+  }
+
+  bool receivingMembership = fChannels.count("membership-in") > 0;
+  boost::thread membershipReceiver;
+  if (receivingMembership) {
+    membershipReceiver = boost::thread(boost::bind(&FLPSender::receiveMembership, this));
+  }
+
+  // base buffer, shared by every timeframe body (only for test mode), in the shared memory segment if there is one.
+  SharedPayload* payload = nullptr;
+  char* shmPayload = nullptr;
+  if (fTestMode > 0) {
+    if (fSharedMemory) {
+      shmPayload = fSharedMemory->Allocate(fEventSize);
+      if (!shmPayload) {
+        LOG(ERROR) << "Shared memory segment too small for the payload, bodies are copied into it for every send";
+      }
+    }
+    if (!shmPayload) {
+      payload = new SharedPayload;
+      payload->data = new char[fEventSize];
+      payload->refCount = 1;
+    }
+  }
 
   fSndMoreFlag = fChannels.at("data-in").at(0).fSocket->SNDMORE;
   fNoBlockFlag = fChannels.at("data-in").at(0).fSocket->NOBLOCK;
 
-  uint16_t timeFrameId = 0;
+  uint64_t timeFrameId = 0;
 
   FairMQChannel& dataInChannel = fChannels.at("data-in").at(0);
+  FairMQPoller* poller = fTransportFactory->CreatePoller(fChannels.at("data-in"));
+
+  // all token buckets start full.
+  chrono::steady_clock::time_point startTimePoint = chrono::steady_clock::now();
+  for (auto& bucket : fTokenBuckets) {
+    bucket.tokens = fSendBurst;
+    bucket.lastRefill = startTimePoint;
+  }
+
+  // time to wait for input before the next buffered sub-timeframe is due.
+  int pollTimeoutInMs = 100;
+
+  chrono::steady_clock::time_point lastQueueReport = startTimePoint;
+  chrono::steady_clock::time_point lastArrival;
+
+  FairMQChannel* metricsOutChannel = (fChannels.count("metrics-out") > 0) ? &(fChannels.at("metrics-out").at(0)) : nullptr;
+  fMetrics.StartPublishing(fId, fMetricsIntervalInMs, fMetricsFile, metricsOutChannel, fTransportFactory);
+
+  bool compressing = false;
+  for (int i = 0; i < fNumEPNs; ++i) {
+    compressing = compressing || fCodecOut[i] != CodecNone;
+  }
+  if (compressing) {
+    fCompression.Start(fCompressionThreads > 0 ? fCompressionThreads : 1);
+  }
 
   while (CheckCurrentState(RUNNING)) {
-    // initialize f2e header
-    f2eHeader* h = new f2eHeader;
-
-    if (fTestMode > 0) {
-      // test-mode: receive and store id part in the buffer.
-      FairMQMessage* idPart = fTransportFactory->CreateMessage();
-      if (dataInChannel.Receive(idPart) > 0) {
-        h->timeFrameId = *(static_cast<uint16_t*>(idPart->GetData()));
+    SubTimeframe* stf = fSendBuffer.Back();
+
+    if (!stf) {
+      // send buffer is full, stop reading the input until sub-timeframes have been released.
+      boost::this_thread::sleep(boost::posix_time::milliseconds(pollTimeoutInMs > 0 ? pollTimeoutInMs : 1));
+      pollTimeoutInMs = releaseDueData();
+      continue;
+    }
+
+    poller->Poll(pollTimeoutInMs);
+
+    if (poller->CheckInput(0)) {
+      FairMQMessage* dataPart = newMessage();
+      uint64_t id = 0;
+      bool received = false;
+
+      if (fTestMode > 0) {
+        // test-mode: receive id part, generate the data part (referencing the shared buffer, without copying it).
+        FairMQMessage* idPart = newMessage();
+        if (dataInChannel.Receive(idPart) == sizeof(uint64_t)) {
+          id = *(static_cast<uint64_t*>(idPart->GetData()));
+          if (shmPayload) {
+            fSharedMemory->Reference(dataPart, shmPayload, fEventSize);
+          } else {
+            payload->refCount.fetch_add(1, memory_order_relaxed);
+            dataPart->Rebuild(payload->data, fEventSize, &releaseSharedPayload, payload);
+          }
+          received = true;
+        }
+        recycle(idPart);
+      } else {
+        // regular mode: receive data part from input, use the id generated locally
+        if (dataInChannel.Receive(dataPart) >= 0) {
+          id = timeFrameId++;
+          received = true;
+        }
+      }
+
+      if (received) {
+        // initialize f2e header, small enough to be stored in the message itself.
+        FairMQMessage* headerPart = newMessage();
+        headerPart->Rebuild(sizeof(F2EHeader));
+        F2EHeader* h = static_cast<F2EHeader*>(headerPart->GetData());
+        h->version = F2EHeader::CurrentVersion;
         h->flpIndex = fIndex;
+        h->codec = CodecNone;
+        h->reserved = 0;
+        h->timeframeId = id;
+
+        // store the sub-timeframe with its arrival time in the send buffer.
+        stf->header = headerPart;
+        stf->data = dataPart;
+        stf->id = id;
+        stf->direction = -1;
+        stf->arrival = chrono::steady_clock::now();
+        fSendBuffer.Push();
+
+        fStfIn->Add();
+        fBytesIn->Add(dataPart->GetSize());
+        if (lastArrival != chrono::steady_clock::time_point()) {
+          fInterArrival->Record(chrono::duration_cast<chrono::microseconds>(stf->arrival - lastArrival).count());
+        }
+        lastArrival = stf->arrival;
       } else {
         // if nothing was received, try again
-        delete h;
-        continue;
+        recycle(dataPart);
       }
+    }
 
-      delete idPart;
-    } else {
-      // regular mode: use the id generated locally
-      h->timeFrameId = timeFrameId;
-      h->flpIndex = fIndex;
+    // LOG(INFO) << fSendBuffer.Size();
+
+    pollTimeoutInMs = releaseDueData();
+
+    fSendBufferOccupancy->Set(fSendBuffer.Size());
+    fOutputQueueOccupancy->Set(fNumQueued);
+
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    if (now - lastQueueReport > chrono::seconds(10)) {
+      reportOutputQueues();
+      lastQueueReport = now;
+    }
+  }
+
+  // drop what could not be sent anymore
+  while (SubTimeframe* stf = fSendBuffer.Front()) {
+    recycle(stf->header);
+    recycle(stf->data);
+    fSendBuffer.Pop();
+  }
+
+  delete poller;
+
+  for (auto& queue : fOutputQueues) {
+    for (auto& part : queue.parts) {
+      discard(part);
+    }
+    queue.parts.clear();
+    queue.headerSent = false;
+  }
+  fNumQueued = 0;
+
+  fCompression.Stop();
+  for (auto& job : fJobPool) {
+    delete job;
+  }
+  fJobPool.clear();
 
-      if (++timeFrameId == UINT16_MAX - 1) {
-        timeFrameId = 0;
+  for (auto& msg : fMessagePool) {
+    delete msg;
+  }
+  fMessagePool.clear();
+
+  if (payload) {
+    // messages still with the transport keep the shared buffer alive.
+    releaseSharedPayload(payload->data, payload);
+  }
+  if (shmPayload) {
+    // as well as descriptors in flight, until the epnReceivers are done with them.
+    fSharedMemory->Release(shmPayload);
+  }
+
+  if (receivingHeartbeats) {
+    heartbeatReceiver.interrupt();
+    heartbeatReceiver.join();
+  }
+
+  if (receivingMembership) {
+    membershipReceiver.interrupt();
+    membershipReceiver.join();
+  }
+
+  fMetrics.StopPublishing();
+}
+
+int FLPSender::selectEPN(uint64_t id)
+{
+  while (MembershipTable::Update* update = fMembershipUpdates.Front()) {
+    if (!fMembership.Add(*update)) {
+      LOG(WARN) << "Membership update for timeframe #" << update->validFromId << " arrived too late, applying it from timeframe #" << id
+                << " (not in sync with the other FLPs)";
+      fMembershipLate->Add();
+    }
+    fMembershipUpdates.Pop();
+  }
+
+  if (fMembership.Apply(id)) {
+    LOG(INFO) << "Switching to " << fMembership.Members().size() << " EPNs from timeframe #" << id;
+    fEPNMembers->Set(fMembership.Members().size());
+    if (fCreditBased) {
+      fCreditScheduler.SetEligible(fMembership.Mask());
+    }
+  }
+
+  if (fCreditBased) {
+    while (CreditScheduler::Update* update = fCreditUpdates.Front()) {
+      if (!fCreditScheduler.Add(*update)) {
+        LOG(WARN) << "Credits of EPN " << update->epnIndex << " for timeframe #" << update->validFromId
+                  << " arrived too late (at timeframe #" << id << "), dropping them until the next advertisement";
+        fCreditsLate->Add();
       }
+      fCreditUpdates.Pop();
+    }
+    return fCreditScheduler.Select(id);
+  }
+
+  const vector<int>& members = fMembership.Members();
+  return members[id % members.size()];
+}
+
+int FLPSender::releaseDueData()
+{
+  const chrono::steady_clock::duration stagger = chrono::milliseconds(fSendDelay * fSendOffset);
+
+  // retry the output queues first, so that they can take the new sub-timeframes.
+  bool retry = fNumQueued > 0 && sendAllQueued(steadyNow());
+
+  while (SubTimeframe* stf = fSendBuffer.Front()) {
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+    // for which EPN is the message? (decided once, when the sub-timeframe reaches the front)
+    if (stf->direction < 0) {
+      stf->direction = selectEPN(stf->id);
     }
 
-    FairMQMessage* headerPart = fTransportFactory->CreateMessage(h, sizeof(f2eHeader));
-    FairMQMessage* dataPart = fTransportFactory->CreateMessage();
+    // staggering: sub-timeframe is due after a fixed delay per flpSender (none if offset is 0).
+    chrono::steady_clock::time_point due = stf->arrival + stagger;
 
-    // save the arrival time of the message.
-    fArrivalTime.push(boost::posix_time::microsec_clock::local_time());
+    // pacing: sub-timeframe is due when the bucket of its destination has no debt.
+    if (fSendRate > 0) {
+      TokenBucket& bucket = fTokenBuckets[stf->direction];
+      bucket.tokens += chrono::duration<double>(now - bucket.lastRefill).count() * fSendRate * 1000000.;
+      if (bucket.tokens > fSendBurst) {
+        bucket.tokens = fSendBurst;
+      }
+      bucket.lastRefill = now;
 
-    if (fTestMode > 0) {
-      // test-mode: initialize and store data part in the buffer.
-      dataPart->Copy(baseMsg);
-      fHeaderBuffer.push(headerPart);
-      fDataBuffer.push(dataPart);
-    } else {
-      // regular mode: receive data part from input
-      if (dataInChannel.Receive(dataPart) >= 0) {
-        fHeaderBuffer.push(headerPart);
-        fDataBuffer.push(dataPart);
-      } else {
-        // if nothing was received, try again
-        continue;
+      if (bucket.tokens < 0) {
+        chrono::steady_clock::time_point paid = now + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(-bucket.tokens / (fSendRate * 1000000.)));
+        if (paid > due) {
+          due = paid;
+        }
       }
     }
 
-    // LOG(INFO) << fDataBuffer.size();
+    if (due > now) {
+      // LOG(INFO) << "buffering...";
+      return retry ? 1 : static_cast<int>(chrono::duration_cast<chrono::milliseconds>(due - now).count()) + 1;
+    }
 
-    // if offset is 0 - send data out without staggering.
-    if (fSendOffset == 0 && fDataBuffer.size() > 0) {
-      sendFrontData();
-    } else if (fDataBuffer.size() > 0) {
-      // size_t dataSize = fDataBuffer.front()->GetSize();
-      ptime now = boost::posix_time::microsec_clock::local_time();
-      if ((now - fArrivalTime.front()).total_milliseconds() >= (fSendDelay * fSendOffset)) {
-        sendFrontData();
-      } else {
-        // LOG(INFO) << "buffering...";
+    // backpressure: a full output queue of a live epnReceiver holds back the release (dead ones are handled by the dead EPN policy).
+    if (fOverflowPolicy == OverflowBlock
+        && fOutputQueues[stf->direction].parts.size() >= static_cast<size_t>(fOutputQueueSize)
+        && (fDeadEPNPolicy == DeadEPNPolicyOff || isAlive(stf->direction, steadyNow()))) {
+      ++fNumBlocked;
+      return 1;
+    }
+
+    if (fSendRate > 0) {
+      fTokenBuckets[stf->direction].tokens -= stf->header->GetSize() + stf->data->GetSize();
+    }
+
+    sendFrontData();
+  }
+
+  return (fNumQueued > 0 && sendAllQueued(steadyNow())) ? 1 : 100;
+}
+
+inline void FLPSender::sendFrontData()
+{
+  SubTimeframe* stf = fSendBuffer.Front();
+  uint64_t currentTimeframeId = stf->id;
+  int direction = stf->direction;
+  // LOG(INFO) << "Sending event " << currentTimeframeId << " to EPN#" << direction << "...";
+
+  FairMQMessage* headerPart = stf->header;
+  FairMQMessage* dataPart = stf->data;
+  fReleaseDelay->Record(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - stf->arrival).count());
+  fSendBuffer.Pop();
+
+  if (fDeadEPNPolicy == DeadEPNPolicyOff) {
+    sendToEPN(direction, headerPart, dataPart);
+    return;
+  }
+
+  // compare with the latest heartbeat from the destination EPN.
+  int64_t now = steadyNow();
+
+  if (isAlive(direction, now)) {
+    if (fEPNDead[direction]) {
+      LOG(INFO) << "EPN#" << direction << " is alive again";
+      fEPNDead[direction] = false;
+    }
+    sendToEPN(direction, headerPart, dataPart);
+    return;
+  }
+
+  if (!fEPNDead[direction]) {
+    LOG(WARN) << "Heartbeat too old for EPN#" << direction << ", applying dead EPN policy \"" << fDeadEPNPolicyName << "\"";
+    fEPNDead[direction] = true;
+  }
+
+  switch (fDeadEPNPolicy) {
+    case DeadEPNPolicyHold:
+      // held in the output queue, which is not sent until the epnReceiver is alive again.
+      if (static_cast<int>(fOutputQueues[direction].parts.size()) >= fHoldLimit) {
+        LOG(WARN) << "Hold limit reached for EPN#" << direction << ", discarding its oldest held sub-timeframe";
+        if (!dropOldest(fOutputQueues[direction])) {
+          break;
+        }
       }
+      enqueue(direction, headerPart, dataPart);
+      return;
+    case DeadEPNPolicyReroute:
+      // the next live member EPN. flpSenders that see the heartbeat timeout at different times can choose differently.
+      {
+        const vector<int>& members = fMembership.Members();
+        size_t position = find(members.begin(), members.end(), direction) - members.begin();
+        for (size_t i = 1; i < members.size(); ++i) {
+          int alternative = members[(position + i) % members.size()];
+          if (isAlive(alternative, now)) {
+            sendToEPN(alternative, headerPart, dataPart);
+            return;
+          }
+        }
+      }
+      LOG(WARN) << "No live EPN to reroute timeframe #" << currentTimeframeId << " to, discarding it";
+      break;
+    default:
+      break;
+  }
+
+  fStfDropped->Add();
+  recycle(headerPart);
+  recycle(dataPart);
+}
+
+void FLPSender::enqueue(int direction, FairMQMessage* headerPart, FairMQMessage* dataPart)
+{
+  QueuedSubTimeframe stf = { headerPart, dataPart, nullptr };
+
+  if (fCodecOut[direction] != CodecNone) {
+    if (fJobPool.empty()) {
+      stf.job = new CompressionPool::Job;
+    } else {
+      stf.job = fJobPool.back();
+      fJobPool.pop_back();
     }
+    stf.job->data = dataPart;
+    stf.job->codec = fCodecOut[direction];
+    stf.job->elementSize = fCodecElementSize;
+    fCompression.Submit(stf.job);
   }
 
-  delete baseMsg;
+  fOutputQueues[direction].parts.push_back(stf);
+  ++fNumQueued;
+}
+
+void FLPSender::finishCompression(QueuedSubTimeframe& stf)
+{
+  CompressionPool::Job* job = stf.job;
 
-  // heartbeatReceiver.interrupt();
-  // heartbeatReceiver.join();
+  if (job->output) {
+    // the body now owns the compressed buffer, the original data is released.
+    fBytesSaved->Add(stf.data->GetSize() - job->outputSize);
+    stf.data->Rebuild(job->output, job->outputSize, &Codec::FreeBuffer, nullptr);
+    static_cast<F2EHeader*>(stf.header->GetData())->codec = job->codec;
+    fStfCompressed->Add();
+  }
+
+  fJobPool.push_back(job);
+  stf.job = nullptr;
 }
 
-inline void FLPSender::sendFrontData()
+void FLPSender::discard(QueuedSubTimeframe& stf)
 {
-  f2eHeader h = *(static_cast<f2eHeader*>(fHeaderBuffer.front()->GetData()));
-  uint16_t currentTimeframeId = h.timeFrameId;
+  if (stf.job) {
+    // the worker may still be reading the body.
+    CompressionPool::Wait(*stf.job);
+    delete[] stf.job->output;
+    fJobPool.push_back(stf.job);
+    stf.job = nullptr;
+  }
 
-  // for which EPN is the message?
-  int direction = currentTimeframeId % fNumEPNs;
-  // LOG(INFO) << "Sending event " << currentTimeframeId << " to EPN#" << direction << "...";
+  recycle(stf.header);
+  recycle(stf.data);
+}
 
-  // // get current time to compare with the latest heartbeat from destination EPN.
-  // ptime currentTime = boost::posix_time::microsec_clock::local_time();
-  // ptime storedHeartbeat;
-  // {
-  //   boost::shared_lock<boost::shared_mutex> lock(fHeartbeatMutex);
-  //   storedHeartbeat = fHeartbeats[fChannels.at("data-out").at(direction).GetAddress()];
-  // }
-
-  // // if the heartbeat is too old, discard the data.
-  // if (to_simple_string(storedHeartbeat) == "not-a-date-time" ||
-  //     (currentTime - storedHeartbeat).total_milliseconds() > fHeartbeatTimeoutInMs) {
-  //   LOG(WARN) << "Heartbeat too old for EPN#" << direction << ", discarding message.";
-  //   fHeaderBuffer.pop();
-  //   fArrivalTime.pop();
-  //   fDataBuffer.pop();
-  // } else { // if the heartbeat from the corresponding EPN is within timeout period, send the data.
-    if (fChannels.at("data-out").at(direction).Send(fHeaderBuffer.front(), fSndMoreFlag|fNoBlockFlag) <= 0) {
-      LOG(ERROR) << "Could not queue ID part of event #" << currentTimeframeId << " without blocking";
+void FLPSender::sendToEPN(int direction, FairMQMessage* headerPart, FairMQMessage* dataPart)
+{
+  OutputQueue& queue = fOutputQueues[direction];
+
+  if (queue.parts.size() >= static_cast<size_t>(fOutputQueueSize)) {
+    // with the block policy the queue can only be full here for rerouted sub-timeframes, make room for them.
+    if (fOverflowPolicy == OverflowDropNewest || !dropOldest(queue)) {
+      ++queue.numDropped;
+      fStfDropped->Add();
+      recycle(headerPart);
+      recycle(dataPart);
+      return;
     }
-    if (fChannels.at("data-out").at(direction).Send(fDataBuffer.front(), fNoBlockFlag) <= 0) {
-      LOG(ERROR) << "Could not send message with event #" << currentTimeframeId << " without blocking";
+  }
+
+  enqueue(direction, headerPart, dataPart);
+  if (queue.parts.size() > queue.maxSize) {
+    queue.maxSize = queue.parts.size();
+  }
+
+  sendQueued(direction);
+}
+
+bool FLPSender::sendQueued(int direction)
+{
+  OutputQueue& queue = fOutputQueues[direction];
+  FairMQChannel& channel = fChannels.at("data-out").at(direction);
+
+  while (!queue.parts.empty()) {
+    QueuedSubTimeframe& stf = queue.parts.front();
+
+    if (!queue.headerSent) {
+      if (stf.job) {
+        // the queue waits for the compression of its front, later sub-timeframes are compressed meanwhile.
+        if (!stf.job->Done()) {
+          return false;
+        }
+        finishCompression(stf);
+      }
+      if (channel.Send(stf.header, fSndMoreFlag|fNoBlockFlag) <= 0) {
+        return false;
+      }
+      queue.headerSent = true;
+    }
+    if (fShmOut[direction]) {
+      if (!sendDescriptor(channel, stf.data)) {
+        return false;
+      }
+    } else if (channel.Send(stf.data, fNoBlockFlag) <= 0) {
+      return false;
     }
-    fHeaderBuffer.pop();
-    fArrivalTime.pop();
-    fDataBuffer.pop();
-  // }
+
+    fStfSent->Add();
+    fBytesOut->Add(stf.header->GetSize() + stf.data->GetSize());
+    recycle(stf.header);
+    recycle(stf.data);
+    queue.parts.pop_front();
+    queue.headerSent = false;
+    --fNumQueued;
+  }
+
+  return true;
+}
+
+bool FLPSender::sendDescriptor(FairMQChannel& channel, FairMQMessage* dataPart)
+{
+  FairMQMessage* descriptorPart = newMessage();
+
+  if (!fSharedMemory->WriteDescriptor(dataPart, descriptorPart)) {
+    // retried with the queue, until the epnReceivers have released enough buffers.
+    fShmFull->Add();
+    recycle(descriptorPart);
+    return false;
+  }
+
+  if (channel.Send(descriptorPart, fNoBlockFlag) <= 0) {
+    // the reference for the receiver stays with us.
+    fSharedMemory->ReleaseDescriptor(descriptorPart);
+    recycle(descriptorPart);
+    return false;
+  }
+
+  recycle(descriptorPart);
+  return true;
+}
+
+bool FLPSender::sendAllQueued(int64_t now)
+{
+  bool pending = false;
+
+  for (int i = 0; i < fNumEPNs; ++i) {
+    if (fOutputQueues[i].parts.empty()) {
+      continue;
+    }
+
+    if (fDeadEPNPolicy != DeadEPNPolicyOff) {
+      if (!isAlive(i, now)) {
+        continue;
+      }
+      if (fEPNDead[i]) {
+        LOG(INFO) << "EPN#" << i << " is alive again, sending " << fOutputQueues[i].parts.size() << " queued sub-timeframes";
+        fEPNDead[i] = false;
+      }
+    }
+
+    if (!sendQueued(i)) {
+      pending = true;
+    }
+  }
+
+  return pending;
+}
+
+bool FLPSender::dropOldest(OutputQueue& queue)
+{
+  // the transport already has the header of a partially sent sub-timeframe, its body has to follow.
+  size_t oldest = queue.headerSent ? 1 : 0;
+  if (queue.parts.size() <= oldest) {
+    return false;
+  }
+
+  discard(queue.parts[oldest]);
+  queue.parts.erase(queue.parts.begin() + oldest);
+  ++queue.numDropped;
+  fStfDropped->Add();
+  --fNumQueued;
+
+  return true;
+}
+
+void FLPSender::reportOutputQueues()
+{
+  for (int i = 0; i < fNumEPNs; ++i) {
+    OutputQueue& queue = fOutputQueues[i];
+    if (queue.numDropped > 0) {
+      LOG(WARN) << "Output queue of EPN#" << i << ": " << queue.parts.size() << " (max " << queue.maxSize << ") of "
+                << fOutputQueueSize << ", dropped " << queue.numDropped << " sub-timeframes";
+    } else {
+      LOG(INFO) << "Output queue of EPN#" << i << ": " << queue.parts.size() << " (max " << queue.maxSize << ") of "
+                << fOutputQueueSize;
+    }
+    queue.maxSize = queue.parts.size();
+    queue.numDropped = 0;
+  }
+
+  if (fNumBlocked > 0) {
+    LOG(WARN) << "Sending was blocked by a full output queue " << fNumBlocked << " times";
+    fNumBlocked = 0;
+  }
 }
 
 void FLPSender::SetProperty(const int key, const string& value)
 {
   switch (key) {
+    case EPNSelection:
+      fEPNSelection = value;
+      break;
+    case DeadEPNPolicy:
+      fDeadEPNPolicyName = value;
+      break;
+    case OverflowPolicy:
+      fOverflowPolicyName = value;
+      break;
+    case MetricsFile:
+      fMetricsFile = value;
+      break;
+    case DataOutTransport:
+      fDataOutTransport = value;
+      break;
+    case ShmSegmentName:
+      fShmSegmentName = value;
+      break;
+    case DataOutCodec:
+      fDataOutCodec = value;
+      break;
     default:
       FairMQDevice::SetProperty(key, value);
       break;
@@ -231,6 +1038,20 @@ void FLPSender::SetProperty(const int key, const string& value)
 string FLPSender::GetProperty(const int key, const string& default_/*= ""*/)
 {
   switch (key) {
+    case EPNSelection:
+      return fEPNSelection;
+    case DeadEPNPolicy:
+      return fDeadEPNPolicyName;
+    case OverflowPolicy:
+      return fOverflowPolicyName;
+    case MetricsFile:
+      return fMetricsFile;
+    case DataOutTransport:
+      return fDataOutTransport;
+    case ShmSegmentName:
+      return fShmSegmentName;
+    case DataOutCodec:
+      return fDataOutCodec;
     default:
       return FairMQDevice::GetProperty(key, default_);
   }
@@ -257,6 +1078,33 @@ void FLPSender::SetProperty(const int key, const int value)
     case EventSize:
       fEventSize = value;
       break;
+    case HoldLimit:
+      fHoldLimit = value;
+      break;
+    case BufferSize:
+      fBufferSize = value;
+      break;
+    case SendRate:
+      fSendRate = value;
+      break;
+    case SendBurst:
+      fSendBurst = value;
+      break;
+    case OutputQueueSize:
+      fOutputQueueSize = value;
+      break;
+    case MetricsIntervalInMs:
+      fMetricsIntervalInMs = value;
+      break;
+    case ShmSegmentSize:
+      fShmSegmentSize = value;
+      break;
+    case CodecElementSize:
+      fCodecElementSize = value;
+      break;
+    case CompressionThreads:
+      fCompressionThreads = value;
+      break;
     default:
       FairMQDevice::SetProperty(key, value);
       break;
@@ -278,6 +1126,24 @@ int FLPSender::GetProperty(const int key, const int default_/*= 0*/)
       return fSendDelay;
     case EventSize:
       return fEventSize;
+    case HoldLimit:
+      return fHoldLimit;
+    case BufferSize:
+      return fBufferSize;
+    case SendRate:
+      return fSendRate;
+    case SendBurst:
+      return fSendBurst;
+    case OutputQueueSize:
+      return fOutputQueueSize;
+    case MetricsIntervalInMs:
+      return fMetricsIntervalInMs;
+    case ShmSegmentSize:
+      return fShmSegmentSize;
+    case CodecElementSize:
+      return fCodecElementSize;
+    case CompressionThreads:
+      return fCompressionThreads;
     default:
       return FairMQDevice::GetProperty(key, default_);
   }
@@ -9,21 +9,68 @@
 #define ALICEO2_DEVICES_FLPSENDER_H_
 
 #include <string>
-#include <queue>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <utility> // pair
 #include <unordered_map>
-
-#include <boost/date_time/posix_time/posix_time.hpp>
+#include <memory>
 
 #include "FairMQDevice.h"
 
+#include "CreditScheduler.h"
+#include "MembershipTable.h"
+#include "SPSCQueue.h"
+#include "DeviceMetrics.h"
+#include "SharedMemorySegment.h"
+#include "CompressionPool.h"
+
 namespace AliceO2 {
 namespace Devices {
 
+/// Buffered sub-timeframe waiting to be sent
+
+struct SubTimeframe
+{
+  FairMQMessage* header; ///< Sub-timeframe header
+  FairMQMessage* data; ///< Sub-timeframe body
+  uint64_t id; ///< Timeframe ID
+  int direction; ///< Index of the target epnReceiver, -1 if not yet selected
+  std::chrono::steady_clock::time_point arrival; ///< Arrival time of the sub-timeframe
+};
+
+/// Token bucket for pacing the output to one epnReceiver
+
+struct TokenBucket
+{
+  double tokens; ///< Bytes that can be sent without waiting (negative: debt to be paid off at the send rate)
+  std::chrono::steady_clock::time_point lastRefill; ///< Last time the bucket was refilled
+};
+
+/// Sub-timeframe in an output queue
+
+struct QueuedSubTimeframe
+{
+  FairMQMessage* header; ///< Sub-timeframe header
+  FairMQMessage* data; ///< Sub-timeframe body
+  CompressionPool::Job* job; ///< Compression of the body in progress, nullptr if none
+};
+
+/// Output queue of one epnReceiver
+
+struct OutputQueue
+{
+  std::deque<QueuedSubTimeframe> parts; ///< Queued sub-timeframes, oldest first
+  bool headerSent; ///< true if the header of the front sub-timeframe is already with the transport, but its body is not
+  size_t maxSize; ///< Highest occupancy since the last report
+  unsigned long numDropped; ///< Number of sub-timeframes dropped because the queue was full
+};
+
 /// Sends sub-timframes to epnReceivers
 ///
-/// Sub-timeframes are received from the previous step (or generated in test-mode)
-/// and are sent to epnReceivers. Target epnReceiver is determined from the timeframe ID:
-/// targetEpnReceiver = timeframeId % numEPNs (numEPNs is same for every flpSender, although some may be inactive).
+/// Sub-timeframes are received from the previous step (or generated in test-mode), buffered and sent to the
+/// epnReceiver selected from the timeframe ID. The policies are described with the device properties below.
 
 class FLPSender : public FairMQDevice
 {
@@ -36,9 +83,40 @@ class FLPSender : public FairMQDevice
       HeartbeatTimeoutInMs, ///< Heartbeat timeout for epnReceivers
       EventSize, ///< Size of the sub-timeframe body (only for test mode)
       TestMode, ///< Run the device in test mode (only syncSampler+flpSender+epnReceiver)
+      EPNSelection, ///< Selection of the target epnReceiver: "round-robin" (members[timeframeId % numMembers]) or "credit" (CreditScheduler, from the advertised free slots)
+      DeadEPNPolicy, ///< Handling of sub-timeframes for epnReceivers without heartbeat within the timeout: "off", "drop", "hold" or "reroute" (sub-timeframes already queued for them are kept until they are alive again)
+      HoldLimit, ///< Maximum number of held sub-timeframes per dead epnReceiver
+      BufferSize, ///< Maximum number of buffered sub-timeframes, released by a timer when due (staggering delay and send rate)
+      SendRate, ///< Output bandwidth per epnReceiver in MB/s (0 - unlimited)
+      SendBurst, ///< Number of bytes that can be sent to an epnReceiver in a burst above the send rate
+      OutputQueueSize, ///< Maximum number of queued sub-timeframes per epnReceiver, sent without blocking
+      OverflowPolicy, ///< Handling of a full output queue: "block", "drop-oldest" or "drop-newest"
+      MetricsFile, ///< File the metrics are appended to (empty - none), they are also published on the optional metrics-out channel
+      MetricsIntervalInMs, ///< Interval for publishing the metrics
+      DataOutTransport, ///< Transport of the data-out channels: "zmq" or "shm" (only a ShmDescriptor is sent), one value for all or a comma-separated list
+      ShmSegmentName, ///< Name of the shared memory segment
+      ShmSegmentSize, ///< Size of the shared memory segment in MB (if it is created)
+      DataOutCodec, ///< Codec of the data-out channels: "none", "lz" or "shuffle-huffman", one value for all or a comma-separated list (bodies are compressed by the CompressionPool when they enter the output queue)
+      CodecElementSize, ///< Element size of the data in bytes, for the byte shuffle
+      CompressionThreads, ///< Number of compression threads
       Last
     };
 
+    /// Handling of sub-timeframes for epnReceivers that missed their heartbeats
+    enum DeadEPNPolicies {
+      DeadEPNPolicyOff, ///< no liveness check
+      DeadEPNPolicyDrop, ///< discard the sub-timeframe
+      DeadEPNPolicyHold, ///< keep the sub-timeframe until the epnReceiver is alive again
+      DeadEPNPolicyReroute ///< send the sub-timeframe to the next live member epnReceiver (flpSenders can disagree on the liveness near the heartbeat timeout and then split a timeframe)
+    };
+
+    /// Handling of full output queues
+    enum OverflowPolicies {
+      OverflowBlock, ///< stop releasing sub-timeframes (and reading the input) until the queue has room
+      OverflowDropOldest, ///< discard the oldest queued sub-timeframe
+      OverflowDropNewest ///< discard the new sub-timeframe
+    };
+
     /// Default constructor
     FLPSender();
     /// Default destructor
@@ -72,12 +150,82 @@ class FLPSender : public FairMQDevice
   private:
     /// Receives heartbeats from epnReceivers
     void receiveHeartbeats();
+    /// Receives membership updates, used only with the membership-in channel
+    void receiveMembership();
+    /// Selects the target epnReceiver for a timeframe
+    int selectEPN(uint64_t id);
+    /// Sends the buffered sub-timeframes that are due
+    /// @return Time in milliseconds until the next buffered sub-timeframe is due (100 if the buffer is empty)
+    int releaseDueData();
     /// Sends the "oldest" element from the sub-timeframe container
     void sendFrontData();
+    /// Appends a sub-timeframe to an output queue, starting the compression of its body for the codec of the channel
+    /// @param direction    Index of the epnReceiver
+    /// @param headerPart   Sub-timeframe header
+    /// @param dataPart     Sub-timeframe body
+    void enqueue(int direction, FairMQMessage* headerPart, FairMQMessage* dataPart);
+    /// Takes over the result of a finished compression: the body and the codec in the header
+    void finishCompression(QueuedSubTimeframe& stf);
+    /// Recycles a queued sub-timeframe that is not sent, after its compression is done
+    void discard(QueuedSubTimeframe& stf);
+    /// Queues a sub-timeframe for an epnReceiver (applying the overflow policy) and sends what its queue can without blocking
+    /// @param direction    Index of the epnReceiver
+    /// @param headerPart   Sub-timeframe header
+    /// @param dataPart     Sub-timeframe body
+    void sendToEPN(int direction, FairMQMessage* headerPart, FairMQMessage* dataPart);
+    /// Sends queued sub-timeframes of an epnReceiver without blocking until the queue is empty or the transport is full
+    /// @param direction    Index of the epnReceiver
+    /// @return             true if the queue is empty
+    bool sendQueued(int direction);
+    /// Retries the output queues of all live epnReceivers
+    /// @param now  Current steady clock time in nanoseconds
+    /// @return     true if a live epnReceiver still has queued sub-timeframes
+    bool sendAllQueued(int64_t now);
+    /// Sends the shared memory descriptor of a sub-timeframe body without blocking
+    /// @param channel      Output channel
+    /// @param dataPart     Sub-timeframe body, copied into the segment if it is not there yet
+    /// @return             true if the transport took the descriptor
+    bool sendDescriptor(FairMQChannel& channel, FairMQMessage* dataPart);
+    /// Parses the data-out transport property into fShmOut
+    void initTransports();
+    /// Parses the data-out codec property into fCodecOut
+    void initCodecs();
+    /// Discards the oldest queued sub-timeframe that is not partially sent
+    /// @return     false if there is no such sub-timeframe
+    bool dropOldest(OutputQueue& queue);
+    /// Logs the occupancy of the output queues
+    void reportOutputQueues();
+    /// Registers the metrics of the device
+    void initMetrics();
+    /// Returns an empty message object, reused from the pool if possible
+    FairMQMessage* newMessage()
+    {
+      if (fMessagePool.empty()) {
+        return fTransportFactory->CreateMessage();
+      }
+      FairMQMessage* msg = fMessagePool.back();
+      fMessagePool.pop_back();
+      return msg;
+    }
+    /// Empties a message object (releasing its data) and returns it to the pool
+    void recycle(FairMQMessage* msg)
+    {
+      msg->Rebuild();
+      fMessagePool.push_back(msg);
+    }
+    /// Checks the liveness table (lock-free)
+    /// @param direction    Index of the epnReceiver
+    /// @param now          Current steady clock time in nanoseconds
+    bool isAlive(int direction, int64_t now) const
+    {
+      return now - fLastHeartbeat[direction].load(std::memory_order_acquire) <= fHeartbeatTimeoutInNs;
+    }
 
-    std::queue<FairMQMessage*> fHeaderBuffer; ///< Stores sub-timeframe headers
-    std::queue<FairMQMessage*> fDataBuffer; ///< Stores sub-timeframe bodies
-    std::queue<boost::posix_time::ptime> fArrivalTime; ///< Stores arrival times of sub-timeframes
+    SPSCQueue<SubTimeframe> fSendBuffer; ///< Stores sub-timeframes (header, body, arrival time) until they are due
+    int fBufferSize; ///< Maximum number of buffered sub-timeframes
+    std::vector<TokenBucket> fTokenBuckets; ///< Pacing state per epnReceiver
+    int fSendRate; ///< Output bandwidth per epnReceiver in MB/s (0 - unlimited)
+    int fSendBurst; ///< Number of bytes that can be sent to an epnReceiver in a burst above the send rate
 
     int fNumEPNs; ///< Number of epnReceivers
     unsigned int fIndex; ///< Index of the flpSender among other flpSenders
@@ -91,8 +239,61 @@ class FLPSender : public FairMQDevice
     int fTestMode; ///< Run the device in test mode (only syncSampler+flpSender+epnReceiver)
 
     int fHeartbeatTimeoutInMs; ///< Heartbeat timeout for epnReceivers
-    std::unordered_map<std::string,boost::posix_time::ptime> fHeartbeats; ///< Stores heartbeats from epnReceiver
-    boost::shared_mutex fHeartbeatMutex; ///< Mutex for heartbeat synchronization
+    int64_t fHeartbeatTimeoutInNs; ///< Heartbeat timeout for epnReceivers, in steady clock nanoseconds
+    std::vector<std::atomic<int64_t>> fLastHeartbeat; ///< Steady clock time (ns) of the last heartbeat per epnReceiver, written by the heartbeat thread
+    std::vector<bool> fEPNDead; ///< Liveness of the epnReceivers as last seen by the sending thread (for logging)
+    std::string fDeadEPNPolicyName; ///< Handling of sub-timeframes for dead epnReceivers: "off", "drop", "hold" or "reroute"
+    int fDeadEPNPolicy; ///< Handling of sub-timeframes for dead epnReceivers, see DeadEPNPolicies
+    int fHoldLimit; ///< Maximum number of held sub-timeframes per dead epnReceiver
+
+    std::vector<OutputQueue> fOutputQueues; ///< Sub-timeframes waiting for the transport, per epnReceiver (also holds those of dead epnReceivers)
+    int fNumQueued; ///< Total number of sub-timeframes in the output queues
+    int fOutputQueueSize; ///< Maximum number of queued sub-timeframes per epnReceiver
+    std::string fOverflowPolicyName; ///< Handling of a full output queue: "block", "drop-oldest" or "drop-newest"
+    int fOverflowPolicy; ///< Handling of a full output queue, see OverflowPolicies
+    unsigned long fNumBlocked; ///< Number of times the release was blocked by a full output queue since the last report
+
+    std::string fEPNSelection; ///< Selection of the target epnReceiver: "round-robin" or "credit"
+    bool fCreditBased; ///< true if the target epnReceiver is selected by fCreditScheduler
+    std::unordered_map<std::string, int> fEPNIndex; ///< Index of the epnReceivers in the data-out channels, by address
+    CreditScheduler fCreditScheduler; ///< Credit-based selection of the target epnReceiver (sending thread)
+    SPSCQueue<CreditScheduler::Update> fCreditUpdates; ///< Credit updates from the heartbeat thread to the sending thread
+    MembershipTable fMembership; ///< epnReceivers that get timeframes (sending thread)
+    SPSCQueue<MembershipTable::Update> fMembershipUpdates; ///< Membership updates from the membership thread to the sending thread
+
+    std::vector<FairMQMessage*> fMessagePool; ///< Message objects ready for reuse (sending thread only)
+
+    DeviceMetrics fMetrics; ///< Device metrics, published by their own thread
+    std::string fMetricsFile; ///< File the metrics are appended to (empty - none)
+    int fMetricsIntervalInMs; ///< Interval for publishing the metrics
+    DeviceMetrics::Counter* fStfIn; ///< Received sub-timeframes
+    DeviceMetrics::Counter* fBytesIn; ///< Received sub-timeframe bytes (bodies)
+    DeviceMetrics::Counter* fStfSent; ///< Sub-timeframes handed to the transport
+    DeviceMetrics::Counter* fBytesOut; ///< Bytes handed to the transport (headers and bodies)
+    DeviceMetrics::Counter* fStfDropped; ///< Sub-timeframes dropped by the overflow or dead EPN policy
+    DeviceMetrics::Gauge* fSendBufferOccupancy; ///< Sub-timeframes in the send buffer
+    DeviceMetrics::Gauge* fOutputQueueOccupancy; ///< Sub-timeframes in all output queues
+    DeviceMetrics::Histogram* fInterArrival; ///< Time between two received sub-timeframes, in microseconds
+    DeviceMetrics::Histogram* fReleaseDelay; ///< Time from the arrival until the release from the send buffer, in microseconds
+    DeviceMetrics::Counter* fShmFull; ///< Sends postponed because the shared memory segment was full
+    DeviceMetrics::Counter* fStfCompressed; ///< Sub-timeframes sent compressed
+    DeviceMetrics::Counter* fBytesSaved; ///< Bytes saved by the compression
+    DeviceMetrics::Gauge* fEPNMembers; ///< Number of member epnReceivers
+    DeviceMetrics::Counter* fMembershipLate; ///< Membership updates received after their timeframe ID was passed
+    DeviceMetrics::Counter* fCreditsLate; ///< Credit updates dropped because they were received after their timeframe ID was passed
+
+    std::string fDataOutTransport; ///< Transport of the data-out channels: "zmq" or "shm", one value for all or a comma-separated list
+    std::vector<bool> fShmOut; ///< true for data-out channels that carry shared memory descriptors
+    std::string fShmSegmentName; ///< Name of the shared memory segment
+    int fShmSegmentSize; ///< Size of the shared memory segment in MB (if it is created)
+    std::unique_ptr<SharedMemorySegment> fSharedMemory; ///< Segment for the shm channels (nullptr if there are none)
+
+    std::string fDataOutCodec; ///< Codec of the data-out channels, one value for all or a comma-separated list
+    std::vector<int> fCodecOut; ///< Codec ID per data-out channel
+    int fCodecElementSize; ///< Element size of the data in bytes, for the byte shuffle
+    int fCompressionThreads; ///< Number of compression threads
+    CompressionPool fCompression; ///< Compression threads (running only if a channel has a codec)
+    std::vector<CompressionPool::Job*> fJobPool; ///< Compression jobs ready for reuse (sending thread only)
 };
 
 } // namespace Devices
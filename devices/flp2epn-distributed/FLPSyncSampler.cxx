@@ -6,23 +6,42 @@
  */
 
 #include <fstream>
+#include <random>
+#include <cstring> // memcpy
+#include <thread> // this_thread::sleep_for, this_thread::yield
 
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
 
 #include "FairMQLogger.h"
+#include "FairMQPoller.h"
 
 #include "FLPSyncSampler.h"
+#include "MembershipUpdate.h"
 
 using namespace std;
-using boost::posix_time::ptime;
-
 using namespace AliceO2::Devices;
 
+/// Current steady clock time in nanoseconds
+static inline int64_t steadyNow()
+{
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 FLPSyncSampler::FLPSyncSampler()
-  : fEventRate(1)
-  , fEventCounter(0)
-  , fTimeframeRTT()
+  : fTimeframeStart()
+  , fIntervalRTT()
+  , fTotalRTT()
+  , fNumUnmatched(0)
+  , fNumPublished(0)
+  , fNextId(1)
+  , fRTTReportInterval(10)
+  , fRTTDumpFile()
+  , fEventRate(1)
+  , fBurstSize(1)
+  , fArrivalMode("fixed")
+  , fMembershipFile()
+  , fMembershipLead(1000)
 {
 }
 
@@ -39,67 +58,159 @@ void FLPSyncSampler::InitTask()
 
 void FLPSyncSampler::Run()
 {
-  boost::thread resetEventCounter(boost::bind(&FLPSyncSampler::ResetEventCounter, this));
+  for (auto& start : fTimeframeStart) {
+    start.store(0, memory_order_relaxed);
+  }
+  fNumPublished = 0;
+
+  uint64_t timeFrameId = 1;
+  fNextId.store(timeFrameId, memory_order_relaxed);
+
   boost::thread ackListener(boost::bind(&FLPSyncSampler::ListenForAcks, this));
 
-  int NOBLOCK = fChannels.at("data-out").at(0).fSocket->NOBLOCK;
+  bool publishingMembership = !fMembershipFile.empty() && fChannels.count("membership-out") > 0;
+  boost::thread membershipPublisher;
+  if (publishingMembership) {
+    membershipPublisher = boost::thread(boost::bind(&FLPSyncSampler::PublishMembership, this));
+  }
 
-  uint16_t timeFrameId = 1;
+  int NOBLOCK = fChannels.at("data-out").at(0).fSocket->NOBLOCK;
 
   FairMQChannel& dataOutputChannel = fChannels.at("data-out").at(0);
 
+  bool poisson = (fArrivalMode == "poisson");
+  if (!poisson && fArrivalMode != "fixed") {
+    LOG(ERROR) << "Unknown arrival mode \"" << fArrivalMode << "\", using fixed";
+  }
+  int burstSize = fBurstSize > 0 ? fBurstSize : 1;
+
+  // mean interval between bursts, in seconds.
+  double interval = fEventRate > 0 ? static_cast<double>(burstSize) / fEventRate : 0;
+  // deadlines further behind than this are skipped instead of caught up.
+  chrono::steady_clock::duration maxLag = chrono::seconds(1);
+
+  mt19937_64 generator(random_device{}());
+  exponential_distribution<double> poissonInterval(interval > 0 ? 1 / interval : 1);
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  chrono::steady_clock::time_point deadline = start;
+  double offset = 0; // time of the next burst since start, in seconds
+  unsigned long numSkipped = 0;
+
   while (CheckCurrentState(RUNNING)) {
-    FairMQMessage* msg = fTransportFactory->CreateMessage(sizeof(uint16_t));
-    memcpy(msg->GetData(), &timeFrameId, sizeof(uint16_t));
+    if (interval > 0 && !WaitUntil(deadline)) {
+      break;
+    }
 
-    if (dataOutputChannel.Send(msg, NOBLOCK) > 0) {
-      fTimeframeRTT[timeFrameId].start = boost::posix_time::microsec_clock::local_time();
+    for (int i = 0; i < burstSize; ++i) {
+      FairMQMessage* msg = fTransportFactory->CreateMessage(sizeof(uint64_t));
+      memcpy(msg->GetData(), &timeFrameId, sizeof(uint64_t));
 
-      if (++timeFrameId == UINT16_MAX - 1) {
-        timeFrameId = 1;
+      // stamped before sending, the acknowledgement can arrive before Send() returns.
+      fTimeframeStart[timeFrameId % fTimeframeStart.size()].store(steadyNow(), memory_order_release);
+
+      if (dataOutputChannel.Send(msg, NOBLOCK) > 0) {
+        ++fNumPublished;
+        ++timeFrameId;
+        fNextId.store(timeFrameId, memory_order_relaxed);
       }
+
+      delete msg;
     }
 
-    --fEventCounter;
+    if (interval > 0) {
+      // absolute deadlines: computed from the start time, so errors in waiting do not add up.
+      offset += poisson ? poissonInterval(generator) : interval;
+      deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(offset));
 
-    while (fEventCounter == 0) {
-      boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+      chrono::steady_clock::time_point now = chrono::steady_clock::now();
+      if (now - deadline > maxLag) {
+        // stalled for too long, skip what is beyond the catch-up window and continue at the nominal rate from now.
+        numSkipped += static_cast<unsigned long>(chrono::duration<double>(now - deadline).count() / interval) * burstSize;
+        LOG(WARN) << "Publishing fell behind by more than " << chrono::duration_cast<chrono::milliseconds>(maxLag).count()
+                  << " ms, skipped " << numSkipped << " timeframe IDs so far";
+        start = now;
+        deadline = now;
+        offset = 0;
+      }
     }
-
-    delete msg;
   }
 
   try {
-    resetEventCounter.interrupt();
-    resetEventCounter.join();
     ackListener.interrupt();
     ackListener.join();
+    if (publishingMembership) {
+      membershipPublisher.interrupt();
+      membershipPublisher.join();
+    }
   } catch(boost::thread_resource_error& e) {
     LOG(ERROR) << e.what();
   }
 }
 
+bool FLPSyncSampler::WaitUntil(const chrono::steady_clock::time_point& deadline)
+{
+  while (true) {
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    if (now >= deadline) {
+      return true;
+    }
+
+    if (deadline - now > chrono::milliseconds(1)) {
+      // sleep until one millisecond before the deadline (in steps, to react to a state change).
+      chrono::steady_clock::duration sleepTime = deadline - now - chrono::milliseconds(1);
+      this_thread::sleep_for(min(sleepTime, chrono::steady_clock::duration(chrono::milliseconds(100))));
+      if (!CheckCurrentState(RUNNING)) {
+        return false;
+      }
+    } else {
+      // sleeping is not precise enough for the remaining time.
+      this_thread::yield();
+    }
+  }
+}
+
 void FLPSyncSampler::ListenForAcks()
 {
-  uint16_t id = 0;
+  FairMQChannel& ackChannel = fChannels.at("ack-in").at(0);
+  // poll with a timeout, so that the reports are written also when no acknowledgements arrive.
+  FairMQPoller* poller = fTransportFactory->CreatePoller(fChannels.at("ack-in"));
+
+  ofstream ofsDump;
+  if (!fRTTDumpFile.empty()) {
+    ofsDump.open(fRTTDumpFile, ios::out | ios::binary | ios::app);
+    if (!ofsDump) {
+      LOG(ERROR) << "Could not open roundtrip time dump file " << fRTTDumpFile;
+    }
+  }
 
-  string name = to_iso_string(boost::posix_time::microsec_clock::local_time()).substr(0, 20);
-  ofstream ofsFrames(name + "-frames.log");
-  ofstream ofsTimes(name + "-times.log");
+  fIntervalRTT.Reset();
+  fTotalRTT.Reset();
+  fNumUnmatched = 0;
+
+  FairMQMessage* idMsg = fTransportFactory->CreateMessage();
+  chrono::steady_clock::time_point lastReport = chrono::steady_clock::now();
 
   while (CheckCurrentState(RUNNING)) {
     try {
-      FairMQMessage* idMsg = fTransportFactory->CreateMessage();
+      boost::this_thread::interruption_point();
+
+      poller->Poll(100);
+      if (poller->CheckInput(0) && ackChannel.Receive(idMsg) == sizeof(uint64_t)) {
+        uint64_t id = *(static_cast<uint64_t*>(idMsg->GetData()));
+        int64_t start = fTimeframeStart[id % fTimeframeStart.size()].exchange(0, memory_order_acq_rel);
 
-      if (fChannels.at("ack-in").at(0).Receive(idMsg) > 0) {
-        id = *(static_cast<uint16_t*>(idMsg->GetData()));
-        fTimeframeRTT.at(id).end = boost::posix_time::microsec_clock::local_time();
-        // store values in a file
-        ofsFrames << id << "\n";
-        ofsTimes  << (fTimeframeRTT.at(id).end - fTimeframeRTT.at(id).start).total_microseconds() << "\n";
+        if (start > 0) {
+          fIntervalRTT.Record((steadyNow() - start) / 1000);
+        } else {
+          ++fNumUnmatched;
+        }
+      }
 
-        LOG(INFO) << "Timeframe #" << id << " acknowledged after "
-                  << (fTimeframeRTT.at(id).end - fTimeframeRTT.at(id).start).total_microseconds() << " μs.";
+      chrono::steady_clock::time_point now = chrono::steady_clock::now();
+      if (now - lastReport >= chrono::seconds(fRTTReportInterval)) {
+        ReportRTT(ofsDump);
+        lastReport = now;
       }
     } catch (boost::thread_interrupted&) {
       LOG(DEBUG) << "Acknowledgement listener thread interrupted";
@@ -107,26 +218,107 @@ void FLPSyncSampler::ListenForAcks()
     }
   }
 
-  ofsFrames.close();
-  ofsTimes.close();
+  ReportRTT(ofsDump);
+  LOG(INFO) << "Roundtrip time total: " << fTotalRTT.Count() << " timeframes, p50 " << fTotalRTT.Percentile(0.5)
+            << " μs, p99 " << fTotalRTT.Percentile(0.99) << " μs, p99.9 " << fTotalRTT.Percentile(0.999)
+            << " μs, max " << fTotalRTT.Max() << " μs";
+
+  delete idMsg;
+  delete poller;
+  ofsDump.close();
 }
 
-void FLPSyncSampler::ResetEventCounter()
+void FLPSyncSampler::PublishMembership()
 {
-  while (true) {
+  FairMQChannel& membershipChannel = fChannels.at("membership-out").at(0);
+  int NOBLOCK = membershipChannel.fSocket->NOBLOCK;
+
+  string members; // addresses of the current members, separated by '\n'
+  MembershipUpdate header;
+  header.validFromId = 0;
+  header.numEPNs = 0;
+  header.reserved = 0;
+  bool readable = true;
+
+  while (CheckCurrentState(RUNNING)) {
     try {
-      fEventCounter = fEventRate / 100;
-      boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+      ifstream file(fMembershipFile.c_str());
+      if (!file) {
+        if (readable) {
+          LOG(ERROR) << "Could not read membership file " << fMembershipFile << ", keeping the current membership";
+        }
+        readable = false;
+      } else {
+        readable = true;
+        string list;
+        string address;
+        uint32_t numEPNs = 0;
+        while (file >> address) {
+          list += (numEPNs > 0 ? "\n" : "") + address;
+          ++numEPNs;
+        }
+
+        if (numEPNs > 0 && list != members) {
+          // far enough ahead for the update to reach all flpSenders before they reach that ID.
+          members.swap(list);
+          header.validFromId = fNextId.load(memory_order_relaxed) + fMembershipLead;
+          header.numEPNs = numEPNs;
+          LOG(INFO) << "Membership changes to " << numEPNs << " EPNs from timeframe #" << header.validFromId;
+        }
+      }
+
+      if (header.numEPNs > 0) {
+        FairMQMessage* msg = fTransportFactory->CreateMessage(sizeof(MembershipUpdate) + members.size());
+        memcpy(msg->GetData(), &header, sizeof(MembershipUpdate));
+        memcpy(static_cast<char*>(msg->GetData()) + sizeof(MembershipUpdate), members.data(), members.size());
+        membershipChannel.Send(msg, NOBLOCK);
+        delete msg;
+      }
+
+      boost::this_thread::sleep(boost::posix_time::milliseconds(500));
     } catch (boost::thread_interrupted&) {
-      LOG(DEBUG) << "Event rate limiter thread interrupted";
+      LOG(DEBUG) << "Membership publisher thread interrupted";
       break;
     }
   }
 }
 
+void FLPSyncSampler::ReportRTT(ostream& os)
+{
+  LOG(INFO) << "Roundtrip time: " << fIntervalRTT.Count() << " timeframes, p50 " << fIntervalRTT.Percentile(0.5)
+            << " μs, p99 " << fIntervalRTT.Percentile(0.99) << " μs, p99.9 " << fIntervalRTT.Percentile(0.999)
+            << " μs, max " << fIntervalRTT.Max() << " μs";
+  if (fNumUnmatched > 0) {
+    LOG(WARN) << "Acknowledgements without a pending timeframe: " << fNumUnmatched;
+  }
+
+  if (os) {
+    int64_t time = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    uint64_t count = fIntervalRTT.Count();
+    uint64_t max = fIntervalRTT.Max();
+    os.write(reinterpret_cast<const char*>(&time), sizeof(time));
+    os.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    os.write(reinterpret_cast<const char*>(&max), sizeof(max));
+    fIntervalRTT.Write(os);
+    os.flush();
+  }
+
+  fTotalRTT.Add(fIntervalRTT);
+  fIntervalRTT.Reset();
+}
+
 void FLPSyncSampler::SetProperty(const int key, const string& value)
 {
   switch (key) {
+    case ArrivalMode:
+      fArrivalMode = value;
+      break;
+    case RTTDumpFile:
+      fRTTDumpFile = value;
+      break;
+    case MembershipFile:
+      fMembershipFile = value;
+      break;
     default:
       FairMQDevice::SetProperty(key, value);
       break;
@@ -136,6 +328,12 @@ void FLPSyncSampler::SetProperty(const int key, const string& value)
 string FLPSyncSampler::GetProperty(const int key, const string& default_ /*= ""*/)
 {
   switch (key) {
+    case ArrivalMode:
+      return fArrivalMode;
+    case RTTDumpFile:
+      return fRTTDumpFile;
+    case MembershipFile:
+      return fMembershipFile;
     default:
       return FairMQDevice::GetProperty(key, default_);
   }
@@ -147,6 +345,15 @@ void FLPSyncSampler::SetProperty(const int key, const int value)
     case EventRate:
       fEventRate = value;
       break;
+    case BurstSize:
+      fBurstSize = value;
+      break;
+    case RTTReportInterval:
+      fRTTReportInterval = value;
+      break;
+    case MembershipLead:
+      fMembershipLead = value;
+      break;
     default:
       FairMQDevice::SetProperty(key, value);
       break;
@@ -158,6 +365,12 @@ int FLPSyncSampler::GetProperty(const int key, const int default_ /*= 0*/)
   switch (key) {
     case EventRate:
       return fEventRate;
+    case BurstSize:
+      return fBurstSize;
+    case RTTReportInterval:
+      return fRTTReportInterval;
+    case MembershipLead:
+      return fMembershipLead;
     default:
       return FairMQDevice::GetProperty(key, default_);
   }
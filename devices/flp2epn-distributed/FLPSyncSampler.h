@@ -9,30 +9,48 @@
 #define ALICEO2_DEVICES_FLPSYNCSAMPLER_H_
 
 #include <string>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint> // UINT64_MAX
 
-#include <boost/date_time/posix_time/posix_time.hpp>
-
 #include "FairMQDevice.h"
 
+#include "LatencyHistogram.h"
+
 namespace AliceO2 {
 namespace Devices {
 
-/// Stores measurment for roundtrip time of a timeframe
-
-struct timeframeDuration
-{
-  boost::posix_time::ptime start;
-  boost::posix_time::ptime end;
-};
-
 /// Publishes timeframes IDs for flpSenders (used only in test mode)
+///
+/// IDs are paced against absolute deadlines on the monotonic clock: the n-th burst is due at start + n * burstSize / rate
+/// (or after exponentially distributed intervals in Poisson mode), so timing errors do not accumulate and a stall
+/// is caught up by sending the overdue IDs right away (at most one second worth of them).
+/// Far deadlines are waited for by sleeping, the last millisecond by yielding, to hold rates up to >100 kHz.
+///
+/// Roundtrip times are measured from the publishing of an ID to its acknowledgement by the epnReceiver.
+/// IDs are 64-bit and do not wrap. Start times are stored in a fixed slot per ID modulo the table size
+/// (atomic, no locks between the two threads), the roundtrip times go into a LatencyHistogram.
+/// Every report interval p50/p99/p99.9/max are logged and, if a dump file is given, a binary record
+/// is appended to it: int64 end of the interval (microseconds since epoch), uint64 count, uint64 max,
+/// followed by the non-empty histogram buckets (see LatencyHistogram::Write()). Values are in microseconds.
+///
+/// With a membership file and a membership-out channel the sampler also decides which epnReceivers get timeframes.
+/// The file lists the data input addresses of the member epnReceivers (separated by whitespace) and is read every
+/// 500 ms. A changed list becomes a MembershipUpdate valid from the timeframe ID membershipLead IDs after the last
+/// published one, which is published to the flpSenders repeatedly, so that late subscribers receive it as well.
 
 class FLPSyncSampler : public FairMQDevice
 {
   public:
     enum {
-      EventRate = FairMQDevice::Last, ///< Publishing rate of the timeframe IDs
+      EventRate = FairMQDevice::Last, ///< Publishing rate of the timeframe IDs (0 - unlimited)
+      BurstSize, ///< Number of timeframe IDs published back-to-back at each deadline
+      ArrivalMode, ///< Distribution of the intervals between bursts: "fixed" or "poisson"
+      RTTReportInterval, ///< Interval in seconds between the roundtrip time summaries
+      RTTDumpFile, ///< File for binary roundtrip time histograms (empty - no dump)
+      MembershipFile, ///< File with the addresses of the member epnReceivers (empty - no membership updates)
+      MembershipLead, ///< Number of timeframe IDs between publishing a membership update and its application
       Last
     };
 
@@ -42,10 +60,10 @@ class FLPSyncSampler : public FairMQDevice
     /// Default destructor
     virtual ~FLPSyncSampler();
 
-    /// Controls the send rate of the timeframe IDs
-    void ResetEventCounter();
     /// Listens for acknowledgements from the epnReceivers when they collected full timeframe
     void ListenForAcks();
+    /// Publishes the membership from the membership file, used only with the membership-out channel
+    void PublishMembership();
 
     /// Set Device properties stored as strings
     /// @param key      Property key
@@ -66,15 +84,38 @@ class FLPSyncSampler : public FairMQDevice
     /// @return         Property value
     virtual int GetProperty(const int key, const int default_ = 0);
 
+    /// Number of timeframe IDs published in the last run (to be read when the device is not running)
+    unsigned long NumPublished() const { return fNumPublished; }
+    /// Roundtrip times of the last run (to be read when the device is not running)
+    const LatencyHistogram& TotalRTT() const { return fTotalRTT; }
+
   protected:
     /// Overloads the InitTask() method of FairMQDevice
     virtual void InitTask();
     /// Overloads the Run() method of FairMQDevice
     virtual void Run();
 
-    std::array<timeframeDuration, UINT16_MAX> fTimeframeRTT; ///< Container for the roundtrip values per timeframe ID
-    int fEventRate; ///< Publishing rate of the timeframe IDs
-    int fEventCounter; ///< Controls the send rate of the timeframe IDs
+    /// Waits until the deadline, sleeping while it is far and yielding for the last millisecond
+    /// @param deadline Time to wait for (monotonic)
+    /// @return         false if the device stopped running while waiting
+    bool WaitUntil(const std::chrono::steady_clock::time_point& deadline);
+    /// Logs the percentiles of the interval histogram, appends it to the dump file and adds it to the total
+    /// @param os   Dump file stream (not used if not open)
+    void ReportRTT(std::ostream& os);
+
+    std::array<std::atomic<int64_t>, UINT16_MAX> fTimeframeStart; ///< Publishing time (steady clock, ns) per timeframe ID modulo the table size, 0 if none pending
+    LatencyHistogram fIntervalRTT; ///< Roundtrip times of the current report interval (ack thread only)
+    LatencyHistogram fTotalRTT; ///< Roundtrip times since the start (ack thread only)
+    unsigned long fNumUnmatched; ///< Acknowledgements without a pending start time (ack thread only)
+    unsigned long fNumPublished; ///< Number of published timeframe IDs (sending thread only)
+    std::atomic<uint64_t> fNextId; ///< Next timeframe ID to be published, read by the membership thread
+    int fRTTReportInterval; ///< Interval in seconds between the roundtrip time summaries
+    std::string fRTTDumpFile; ///< File for binary roundtrip time histograms (empty - no dump)
+    int fEventRate; ///< Publishing rate of the timeframe IDs (0 - unlimited)
+    int fBurstSize; ///< Number of timeframe IDs published back-to-back at each deadline
+    std::string fArrivalMode; ///< Distribution of the intervals between bursts: "fixed" or "poisson"
+    std::string fMembershipFile; ///< File with the addresses of the member epnReceivers (empty - no membership updates)
+    int fMembershipLead; ///< Number of timeframe IDs between publishing a membership update and its application
 };
 
 } // namespace Devices
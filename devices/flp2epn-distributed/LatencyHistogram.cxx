@@ -0,0 +1,94 @@
+/**
+ * LatencyHistogram.cxx
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#include <algorithm> // fill
+
+#include "LatencyHistogram.h"
+
+using namespace std;
+using namespace AliceO2::Devices;
+
+LatencyHistogram::LatencyHistogram()
+  : fCounts(OverflowIndex + 1, 0)
+  , fCount(0)
+  , fMax(0)
+{
+}
+
+void LatencyHistogram::Add(const LatencyHistogram& other)
+{
+  for (size_t i = 0; i < fCounts.size(); ++i) {
+    fCounts[i] += other.fCounts[i];
+  }
+  fCount += other.fCount;
+  if (other.fMax > fMax) {
+    fMax = other.fMax;
+  }
+}
+
+void LatencyHistogram::Reset()
+{
+  fill(fCounts.begin(), fCounts.end(), 0);
+  fCount = 0;
+  fMax = 0;
+}
+
+uint64_t LatencyHistogram::LowestValue(uint32_t index)
+{
+  if (index < SubBucketCount) {
+    return index;
+  }
+  uint32_t shift = (index - SubBucketCount) / SubBucketHalfCount + 1;
+  uint64_t subBucket = (index - SubBucketCount) % SubBucketHalfCount + SubBucketHalfCount;
+  return subBucket << shift;
+}
+
+uint64_t LatencyHistogram::Percentile(double fraction) const
+{
+  if (fCount == 0) {
+    return 0;
+  }
+
+  // rank of the requested value, at least the first one
+  uint64_t rank = static_cast<uint64_t>(fraction * fCount + 0.5);
+  if (rank == 0) {
+    rank = 1;
+  }
+
+  uint64_t sum = 0;
+  for (size_t i = 0; i < fCounts.size(); ++i) {
+    sum += fCounts[i];
+    if (sum >= rank) {
+      if (i + 1 == fCounts.size()) {
+        return fMax;
+      }
+      uint64_t upper = LowestValue(i + 1) - 1;
+      return upper < fMax ? upper : fMax;
+    }
+  }
+
+  return fMax;
+}
+
+void LatencyHistogram::Write(ostream& os) const
+{
+  uint32_t numBuckets = 0;
+  for (auto count : fCounts) {
+    if (count > 0) {
+      ++numBuckets;
+    }
+  }
+
+  os.write(reinterpret_cast<const char*>(&numBuckets), sizeof(numBuckets));
+
+  for (uint32_t i = 0; i < fCounts.size(); ++i) {
+    if (fCounts[i] > 0) {
+      os.write(reinterpret_cast<const char*>(&i), sizeof(i));
+      os.write(reinterpret_cast<const char*>(&fCounts[i]), sizeof(fCounts[i]));
+    }
+  }
+}
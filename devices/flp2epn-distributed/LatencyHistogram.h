@@ -0,0 +1,91 @@
+/**
+ * LatencyHistogram.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef ALICEO2_DEVICES_LATENCYHISTOGRAM_H_
+#define ALICEO2_DEVICES_LATENCYHISTOGRAM_H_
+
+#include <vector>
+#include <ostream>
+#include <cstdint>
+
+namespace AliceO2 {
+namespace Devices {
+
+/// Log-linear histogram of latencies (HDR-style)
+///
+/// Values below 128 have their own bucket, above that every power of two is divided into 64 buckets,
+/// so the relative error of a percentile is below 1.6% over the whole range (up to 2^41).
+/// Larger values are counted in a separate overflow bucket.
+/// Recording is O(1) without allocations. Not thread-safe: meant to be filled and read by one thread.
+
+class LatencyHistogram
+{
+  public:
+    /// Default constructor, allocates all buckets
+    LatencyHistogram();
+
+    /// Records a value
+    void Record(uint64_t value)
+    {
+      ++fCounts[Index(value)];
+      ++fCount;
+      if (value > fMax) {
+        fMax = value;
+      }
+    }
+
+    /// Adds the counts of another histogram
+    void Add(const LatencyHistogram& other);
+    /// Clears all counts
+    void Reset();
+
+    /// Value below which the given fraction of the recorded values lies (upper edge of its bucket, at most the maximum)
+    /// @param fraction Fraction of the recorded values, e.g. 0.99 for the 99th percentile
+    uint64_t Percentile(double fraction) const;
+
+    /// Number of recorded values
+    uint64_t Count() const { return fCount; }
+    /// Highest recorded value
+    uint64_t Max() const { return fMax; }
+
+    /// Writes the non-empty buckets in binary form:
+    /// uint32 number of non-empty buckets, followed by (uint32 bucket index, uint64 count) for each of them.
+    /// The lowest value of a bucket is given by LowestValue().
+    void Write(std::ostream& os) const;
+
+    /// Lowest value counted in the bucket with the given index
+    static uint64_t LowestValue(uint32_t index);
+
+  private:
+    static const int SubBucketBits = 7; ///< 2^SubBucketBits linear buckets below the first power of two split
+    static const int SubBucketCount = 1 << SubBucketBits;
+    static const int SubBucketHalfCount = SubBucketCount / 2;
+    static const int MaxShift = 34; ///< Values up to 2^(SubBucketBits + MaxShift) are counted separately
+    static const int OverflowIndex = SubBucketCount + MaxShift * SubBucketHalfCount; ///< Bucket of the values beyond the range
+
+    /// Bucket index of a value (values beyond the range go into the overflow bucket)
+    static uint32_t Index(uint64_t value)
+    {
+      if (value < SubBucketCount) {
+        return value;
+      }
+      int shift = 63 - __builtin_clzll(value) - (SubBucketBits - 1);
+      if (shift > MaxShift) {
+        return OverflowIndex;
+      }
+      return SubBucketCount + (shift - 1) * SubBucketHalfCount + (value >> shift) - SubBucketHalfCount;
+    }
+
+    std::vector<uint64_t> fCounts; ///< Counts per bucket
+    uint64_t fCount; ///< Number of recorded values
+    uint64_t fMax; ///< Highest recorded value
+};
+
+} // namespace Devices
+} // namespace AliceO2
+
+#endif
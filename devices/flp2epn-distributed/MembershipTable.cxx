@@ -0,0 +1,77 @@
+/**
+ * MembershipTable.cxx
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#include "MembershipTable.h"
+
+using namespace std;
+using namespace AliceO2::Devices;
+
+MembershipTable::MembershipTable()
+  : fMembers()
+  , fMask()
+  , fValidFromId(0)
+  , fLastId(0)
+  , fStarted(false)
+  , fPending()
+{
+}
+
+void MembershipTable::Init(int numEPNs)
+{
+  fMembers.clear();
+  for (int i = 0; i < numEPNs; ++i) {
+    fMembers.push_back(i);
+  }
+  fMask.assign(numEPNs, true);
+  fValidFromId = 0;
+  fLastId = 0;
+  fStarted = false;
+  fPending.clear();
+}
+
+bool MembershipTable::Add(const Update& update)
+{
+  if (!fStarted || update.validFromId > fLastId) {
+    fPending[update.validFromId] = update.members;
+    return true;
+  }
+
+  // repeated publishing of the current or of an already replaced membership.
+  if (update.validFromId < fValidFromId || (update.validFromId == fValidFromId && update.members == fMembers)) {
+    return true;
+  }
+
+  // too late to switch together with the other flpSenders, but later IDs have to follow the update as well.
+  fPending[fLastId + 1] = update.members;
+  return false;
+}
+
+bool MembershipTable::Apply(uint64_t id)
+{
+  fLastId = id;
+  fStarted = true;
+
+  bool changed = false;
+
+  while (!fPending.empty() && fPending.begin()->first <= id) {
+    if (fPending.begin()->second != fMembers) {
+      fMembers.swap(fPending.begin()->second);
+      changed = true;
+    }
+    fValidFromId = fPending.begin()->first;
+    fPending.erase(fPending.begin());
+  }
+
+  if (changed) {
+    fMask.assign(fMask.size(), false);
+    for (int member : fMembers) {
+      fMask[member] = true;
+    }
+  }
+
+  return changed;
+}
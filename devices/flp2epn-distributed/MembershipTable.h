@@ -0,0 +1,69 @@
+/**
+ * MembershipTable.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef ALICEO2_DEVICES_MEMBERSHIPTABLE_H_
+#define ALICEO2_DEVICES_MEMBERSHIPTABLE_H_
+
+#include <vector>
+#include <map>
+#include <cstdint>
+
+namespace AliceO2 {
+namespace Devices {
+
+/// Set of epnReceivers that get timeframes, changing at a given timeframe ID
+///
+/// The data-out channels configured at the start are the pool of epnReceivers, of which the members are selected.
+/// Every flpSender applies an update exactly at its timeframe ID, so all flpSenders that received the update
+/// before reaching that ID switch at the same timeframe, and no timeframe is split between two epnReceivers.
+/// Until the first update all epnReceivers are members, in the order of the data-out channels.
+/// Only used from the sending thread.
+
+class MembershipTable
+{
+  public:
+    /// New membership
+    struct Update
+    {
+      uint64_t validFromId; ///< First timeframe ID to which the membership applies
+      std::vector<int> members; ///< Indices of the member epnReceivers in the data-out channels, in selection order
+    };
+
+    /// Default constructor
+    MembershipTable();
+
+    /// Makes all epnReceivers members
+    /// @param numEPNs  Number of epnReceivers
+    void Init(int numEPNs);
+
+    /// Queues an update, to be applied when its timeframe ID is reached. Repeated updates are ignored.
+    /// @return false if the ID was already passed, the update then applies from the next timeframe on
+    bool Add(const Update& update);
+
+    /// Applies all updates due at this ID. IDs are expected in sending order.
+    /// @param id   Timeframe ID
+    /// @return     true if the members changed
+    bool Apply(uint64_t id);
+
+    /// Current members, in selection order
+    const std::vector<int>& Members() const { return fMembers; }
+    /// Current membership per epnReceiver
+    const std::vector<bool>& Mask() const { return fMask; }
+
+  private:
+    std::vector<int> fMembers; ///< Current members, in selection order
+    std::vector<bool> fMask; ///< true for the current members, per epnReceiver
+    uint64_t fValidFromId; ///< Timeframe ID from which the current members apply
+    uint64_t fLastId; ///< Last timeframe ID passed to Apply()
+    bool fStarted; ///< true after the first Apply()
+    std::map<uint64_t, std::vector<int>> fPending; ///< Members not yet due, by the timeframe ID from which they apply
+};
+
+} // namespace Devices
+} // namespace AliceO2
+
+#endif
@@ -0,0 +1,31 @@
+/**
+ * MembershipUpdate.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef ALICEO2_DEVICES_MEMBERSHIPUPDATE_H_
+#define ALICEO2_DEVICES_MEMBERSHIPUPDATE_H_
+
+#include <cstdint>
+
+namespace AliceO2 {
+namespace Devices {
+
+/// Change of the set of epnReceivers that get timeframes, published to the flpSenders on their membership-in channel
+///
+/// The struct is followed in the message by the data input addresses of the member epnReceivers in selection order,
+/// separated by '\n' (not null-terminated). The same update may be published repeatedly.
+
+struct MembershipUpdate
+{
+  uint64_t validFromId; ///< First timeframe ID to which the new membership applies
+  uint32_t numEPNs; ///< Number of member epnReceivers
+  uint32_t reserved; ///< Padding, set to 0
+};
+
+} // namespace Devices
+} // namespace AliceO2
+
+#endif
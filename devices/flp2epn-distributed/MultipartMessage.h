@@ -0,0 +1,61 @@
+/**
+ * MultipartMessage.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef ALICEO2_DEVICES_MULTIPARTMESSAGE_H_
+#define ALICEO2_DEVICES_MULTIPARTMESSAGE_H_
+
+#include <vector>
+#include <cstdint>
+
+#include "FairMQChannel.h"
+#include "FairMQMessage.h"
+
+namespace AliceO2 {
+namespace Devices {
+
+/// Sends a vector of messages as one multipart message and takes ownership of all of them
+///
+/// All parts but the last are sent with the 'more' flag, empty (nullptr) entries are skipped.
+/// The message objects are deleted and the entries reset to nullptr, so the caller keeps the (preallocated) vector
+/// for the next message without any per-part bookkeeping. If a part cannot be sent, the remaining ones are deleted
+/// unsent: with ZeroMQ only the first part can fail without blocking, the others follow it atomically.
+/// @param channel      Output channel
+/// @param parts        Parts in sending order
+/// @param sndMoreFlag  Transport flag for multipart sending (FairMQSocket::SNDMORE)
+/// @param flags        Additional flags for all parts, e.g. FairMQSocket::NOBLOCK
+/// @return             Number of bytes sent, -1 if a part could not be sent
+inline int64_t SendParts(FairMQChannel& channel, std::vector<FairMQMessage*>& parts, int sndMoreFlag, int flags = 0)
+{
+  int64_t totalSize = 0;
+
+  // the last part is sent without the 'more' flag
+  size_t last = parts.size();
+  while (last > 0 && !parts[last - 1]) {
+    --last;
+  }
+
+  for (size_t i = 0; i < parts.size(); ++i) {
+    if (!parts[i]) {
+      continue;
+    }
+
+    if (totalSize >= 0) {
+      int size = channel.Send(parts[i], (i + 1 < last) ? (sndMoreFlag | flags) : flags);
+      totalSize = (size < 0 || (size == 0 && parts[i]->GetSize() > 0)) ? -1 : totalSize + size;
+    }
+
+    delete parts[i];
+    parts[i] = nullptr;
+  }
+
+  return totalSize;
+}
+
+} // namespace Devices
+} // namespace AliceO2
+
+#endif
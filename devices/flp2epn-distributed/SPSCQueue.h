@@ -0,0 +1,107 @@
+/**
+ * SPSCQueue.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef ALICEO2_DEVICES_SPSCQUEUE_H_
+#define ALICEO2_DEVICES_SPSCQUEUE_H_
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+namespace AliceO2 {
+namespace Devices {
+
+/// Bounded lock-free queue for one producer and one consumer thread
+///
+/// Elements are preallocated and stay in place: the producer fills the element returned by Back()
+/// and publishes it with Push(), the consumer reads the element returned by Front() and frees it with Pop().
+/// Elements can therefore carry their own buffers, which are reused instead of reallocated.
+
+template<typename T>
+class SPSCQueue
+{
+  public:
+    /// Constructor
+    /// @param capacity Maximum number of elements in the queue
+    explicit SPSCQueue(size_t capacity = 0)
+      : fElements(capacity + 1)
+      , fPad1()
+      , fHead(0)
+      , fPad2()
+      , fTail(0)
+    {
+    }
+
+    /// Reallocates the queue. Not thread-safe, call only while no producer and consumer are active.
+    void Resize(size_t capacity)
+    {
+      fElements.clear();
+      fElements.resize(capacity + 1);
+      fHead.store(0);
+      fTail.store(0);
+    }
+
+    /// Producer: returns the element to be filled, or nullptr if the queue is full
+    T* Back()
+    {
+      const size_t tail = fTail.load(std::memory_order_relaxed);
+      if (Next(tail) == fHead.load(std::memory_order_acquire)) {
+        return nullptr;
+      }
+      return &fElements[tail];
+    }
+
+    /// Producer: publishes the element returned by Back()
+    void Push()
+    {
+      fTail.store(Next(fTail.load(std::memory_order_relaxed)), std::memory_order_release);
+    }
+
+    /// Consumer: returns the oldest element, or nullptr if the queue is empty
+    T* Front()
+    {
+      const size_t head = fHead.load(std::memory_order_relaxed);
+      if (head == fTail.load(std::memory_order_acquire)) {
+        return nullptr;
+      }
+      return &fElements[head];
+    }
+
+    /// Consumer: frees the element returned by Front()
+    void Pop()
+    {
+      fHead.store(Next(fHead.load(std::memory_order_relaxed)), std::memory_order_release);
+    }
+
+    /// Number of elements in the queue (approximate while producer and consumer are active)
+    size_t Size() const
+    {
+      const size_t head = fHead.load(std::memory_order_acquire);
+      const size_t tail = fTail.load(std::memory_order_acquire);
+      return (tail >= head) ? (tail - head) : (tail + fElements.size() - head);
+    }
+
+    /// Maximum number of elements in the queue
+    size_t Capacity() const { return fElements.size() - 1; }
+
+    /// Access to all elements (for preallocation of their buffers), not thread-safe
+    std::vector<T>& Elements() { return fElements; }
+
+  private:
+    size_t Next(size_t index) const { return (index + 1 == fElements.size()) ? 0 : index + 1; }
+
+    std::vector<T> fElements; ///< Ring of elements, one more than the capacity to distinguish full from empty
+    char fPad1[64]; ///< Keeps the indices on separate cache lines
+    std::atomic<size_t> fHead; ///< Index of the oldest element, written by the consumer
+    char fPad2[64]; ///< Keeps the indices on separate cache lines
+    std::atomic<size_t> fTail; ///< Index of the next free element, written by the producer
+};
+
+} // namespace Devices
+} // namespace AliceO2
+
+#endif
@@ -0,0 +1,130 @@
+/**
+ * SharedMemorySegment.cxx
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#include <cstring> // memcpy
+
+#include "FairMQLogger.h"
+#include "FairMQMessage.h"
+
+#include "SharedMemorySegment.h"
+
+using namespace std;
+using namespace AliceO2::Devices;
+
+namespace bipc = boost::interprocess;
+
+SharedMemorySegment::SharedMemorySegment(const string& name, size_t size)
+  : fName(name)
+  , fSegment(bipc::open_or_create, name.c_str(), size)
+  , fBegin(static_cast<const char*>(fSegment.get_address()))
+  , fEnd(static_cast<const char*>(fSegment.get_address()) + fSegment.get_size())
+{
+  LOG(INFO) << "Opened shared memory segment " << fName << " (" << fSegment.get_size() << " bytes, "
+            << fSegment.get_free_memory() << " free)";
+}
+
+SharedMemorySegment::~SharedMemorySegment()
+{
+}
+
+char* SharedMemorySegment::Allocate(size_t size)
+{
+  void* buffer = fSegment.allocate(sizeof(BufferHeader) + size, nothrow);
+
+  if (!buffer) {
+    return nullptr;
+  }
+
+  BufferHeader* header = new (buffer) BufferHeader;
+  header->refCount.store(1, memory_order_relaxed);
+  header->reserved = 0;
+  header->size = size;
+
+  return static_cast<char*>(buffer) + sizeof(BufferHeader);
+}
+
+void SharedMemorySegment::AddRef(char* data)
+{
+  Header(data)->refCount.fetch_add(1, memory_order_relaxed);
+}
+
+void SharedMemorySegment::Release(char* data)
+{
+  BufferHeader* header = Header(data);
+  if (header->refCount.fetch_sub(1, memory_order_acq_rel) == 1) {
+    header->~BufferHeader();
+    fSegment.deallocate(header);
+  }
+}
+
+bool SharedMemorySegment::Contains(const void* ptr) const
+{
+  return ptr >= fBegin && ptr < fEnd;
+}
+
+void SharedMemorySegment::ReleaseBuffer(void* data, void* hint)
+{
+  static_cast<SharedMemorySegment*>(hint)->Release(static_cast<char*>(data));
+}
+
+void SharedMemorySegment::Reference(FairMQMessage* msg, char* data, size_t size)
+{
+  AddRef(data);
+  msg->Rebuild(data, size, &SharedMemorySegment::ReleaseBuffer, this);
+}
+
+bool SharedMemorySegment::WriteDescriptor(FairMQMessage* dataPart, FairMQMessage* descriptorPart)
+{
+  char* data = static_cast<char*>(dataPart->GetData());
+  size_t size = dataPart->GetSize();
+
+  if (!Contains(data)) {
+    char* buffer = Allocate(size);
+    if (!buffer) {
+      return false;
+    }
+    memcpy(buffer, data, size);
+    // the message holds the reference of the new buffer, retries do not copy again.
+    dataPart->Rebuild(buffer, size, &SharedMemorySegment::ReleaseBuffer, this);
+    data = buffer;
+  }
+
+  AddRef(data);
+
+  descriptorPart->Rebuild(sizeof(ShmDescriptor));
+  ShmDescriptor* descriptor = static_cast<ShmDescriptor*>(descriptorPart->GetData());
+  descriptor->handle = fSegment.get_handle_from_address(data);
+  descriptor->size = size;
+
+  return true;
+}
+
+void SharedMemorySegment::ReleaseDescriptor(FairMQMessage* descriptorPart)
+{
+  ShmDescriptor* descriptor = static_cast<ShmDescriptor*>(descriptorPart->GetData());
+  Release(static_cast<char*>(fSegment.get_address_from_handle(descriptor->handle)));
+}
+
+bool SharedMemorySegment::Attach(FairMQMessage* msg)
+{
+  if (msg->GetSize() != sizeof(ShmDescriptor)) {
+    LOG(ERROR) << "Received " << msg->GetSize() << " bytes instead of a shared memory descriptor";
+    return false;
+  }
+
+  ShmDescriptor descriptor = *(static_cast<ShmDescriptor*>(msg->GetData()));
+
+  if (descriptor.handle < sizeof(BufferHeader) || descriptor.handle + descriptor.size > fSegment.get_size()) {
+    LOG(ERROR) << "Shared memory descriptor (" << descriptor.handle << ", " << descriptor.size << ") outside of segment " << fName;
+    return false;
+  }
+
+  char* data = static_cast<char*>(fSegment.get_address_from_handle(descriptor.handle));
+  msg->Rebuild(data, descriptor.size, &SharedMemorySegment::ReleaseBuffer, this);
+
+  return true;
+}
@@ -0,0 +1,100 @@
+/**
+ * SharedMemorySegment.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef ALICEO2_DEVICES_SHAREDMEMORYSEGMENT_H_
+#define ALICEO2_DEVICES_SHAREDMEMORYSEGMENT_H_
+
+#include <string>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/interprocess/managed_shared_memory.hpp>
+
+class FairMQMessage;
+
+namespace AliceO2 {
+namespace Devices {
+
+/// Descriptor of a buffer in the shared memory segment, sent through the socket instead of the data
+
+struct ShmDescriptor
+{
+  uint64_t handle; ///< Offset of the buffer in the segment
+  uint64_t size; ///< Size of the data in bytes
+};
+
+/// Named shared memory segment for passing data between devices on the same host
+///
+/// Data is written once into a reference-counted buffer of the segment. A sender passes only a ShmDescriptor
+/// through its (ZeroMQ) channel, together with one reference to the buffer, which the receiver takes over.
+/// Buffers are freed by whichever process releases the last reference. All devices using the same name share
+/// one segment: it is created by the first one and not removed when the devices stop (remove /dev/shm/<name>
+/// after the run). Thread-safe, the release may happen in the I/O thread of the transport.
+
+class SharedMemorySegment
+{
+  public:
+    /// Opens the segment, creating it if it does not exist yet
+    /// @param name     Name of the segment
+    /// @param size     Size of the segment in bytes (if it is created)
+    SharedMemorySegment(const std::string& name, size_t size);
+    /// Destructor, unmaps the segment
+    ~SharedMemorySegment();
+
+    /// Allocates a buffer holding one reference
+    /// @param size Size of the data in bytes
+    /// @return     Pointer to the data, nullptr if the segment is full
+    char* Allocate(size_t size);
+    /// Adds a reference to a buffer
+    void AddRef(char* data);
+    /// Releases a reference to a buffer, the last one frees it
+    void Release(char* data);
+    /// true if the pointer is inside the segment
+    bool Contains(const void* ptr) const;
+
+    /// Rebuilds a message to reference a buffer, with a reference held until the transport is done with the message
+    void Reference(FairMQMessage* msg, char* data, size_t size);
+    /// Writes the descriptor of the data of a message, adding the reference that is passed on with the descriptor.
+    /// Data not yet in the segment is copied into a new buffer once, and the message is rebuilt to reference it.
+    /// @param dataPart         Message with the data
+    /// @param descriptorPart   Message to be filled with the ShmDescriptor
+    /// @return                 false if the segment is full
+    bool WriteDescriptor(FairMQMessage* dataPart, FairMQMessage* descriptorPart);
+    /// Releases the reference of a descriptor that was not sent
+    void ReleaseDescriptor(FairMQMessage* descriptorPart);
+    /// Rebuilds a received descriptor message to reference the buffer, taking over the reference of the descriptor
+    /// @return false if the message is not a valid descriptor
+    bool Attach(FairMQMessage* msg);
+
+    /// Name of the segment
+    const std::string& Name() const { return fName; }
+
+    /// Free function for messages referencing a buffer (hint: the segment)
+    static void ReleaseBuffer(void* data, void* hint);
+
+  private:
+    /// Precedes the data of every buffer in the segment
+    struct BufferHeader
+    {
+      std::atomic<int32_t> refCount; ///< References held by messages and descriptors in flight (in any process)
+      uint32_t reserved; ///< Padding, keeps the data 16-byte aligned
+      uint64_t size; ///< Size of the data in bytes
+    };
+
+    static BufferHeader* Header(char* data) { return reinterpret_cast<BufferHeader*>(data - sizeof(BufferHeader)); }
+
+    std::string fName; ///< Name of the segment
+    boost::interprocess::managed_shared_memory fSegment; ///< Mapped segment with its allocator
+    const char* fBegin; ///< First byte of the mapping
+    const char* fEnd; ///< One past the last byte of the mapping
+};
+
+} // namespace Devices
+} // namespace AliceO2
+
+#endif
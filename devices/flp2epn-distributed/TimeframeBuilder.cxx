@@ -0,0 +1,122 @@
+/**
+ * TimeframeBuilder.cxx
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#include "TimeframeBuilder.h"
+
+using namespace std;
+using namespace AliceO2::Devices;
+
+TimeframeBuilder::TimeframeBuilder()
+  : fSlots()
+  , fDeadlines()
+  , fDeadlineHead(0)
+  , fNumDeadlines(0)
+  , fTimeout()
+  , fNumParts(0)
+  , fWindow(0)
+  , fSize(0)
+{
+}
+
+TimeframeBuilder::~TimeframeBuilder()
+{
+  for (auto& tf : fSlots) {
+    if (tf.inUse) {
+      Release(tf, true);
+    }
+  }
+}
+
+void TimeframeBuilder::Init(int numParts, int window, int timeoutInMs)
+{
+  for (auto& tf : fSlots) {
+    if (tf.inUse) {
+      Release(tf, true);
+    }
+  }
+
+  fNumParts = numParts;
+  fWindow = window;
+  fSize = 0;
+  fTimeout = chrono::milliseconds(timeoutInMs);
+
+  // at most one live deadline per slot, the other half of the ring takes the stale ones.
+  fDeadlines.assign(2 * fWindow, Deadline());
+  fDeadlineHead = 0;
+  fNumDeadlines = 0;
+  fSlots.clear();
+  fSlots.resize(fWindow);
+
+  for (auto& tf : fSlots) {
+    tf.parts.resize(fNumParts, nullptr);
+    tf.arrived.resize((fNumParts + 63) / 64, 0);
+    tf.numParts = 0;
+    tf.id = 0;
+    tf.inUse = false;
+    tf.used = false;
+    tf.generation = 0;
+  }
+}
+
+TFBuffer* TimeframeBuilder::NextExpired(const chrono::steady_clock::time_point& now)
+{
+  while (fNumDeadlines > 0) {
+    const Deadline& d = fDeadlines[fDeadlineHead];
+    TFBuffer& tf = fSlots[d.slot];
+
+    // a stale entry (timeframe completed or discarded in the meantime) is just removed.
+    if (IsLive(d) && d.time >= now) {
+      return nullptr;
+    }
+
+    bool expired = IsLive(d);
+    fDeadlineHead = (fDeadlineHead + 1) % fDeadlines.size();
+    --fNumDeadlines;
+
+    if (expired) {
+      return &tf;
+    }
+  }
+
+  return nullptr;
+}
+
+void TimeframeBuilder::CompactDeadlines()
+{
+  // the kept entries move towards the head, so they can be compacted in place.
+  size_t kept = 0;
+
+  for (size_t i = 0; i < fNumDeadlines; ++i) {
+    const Deadline& d = fDeadlines[(fDeadlineHead + i) % fDeadlines.size()];
+    if (IsLive(d)) {
+      fDeadlines[(fDeadlineHead + kept) % fDeadlines.size()] = d;
+      ++kept;
+    }
+  }
+
+  fNumDeadlines = kept;
+}
+
+void TimeframeBuilder::Release(TFBuffer& tf, bool deleteParts)
+{
+  if (tf.numParts > 0) {
+    for (int i = 0; i < fNumParts; ++i) {
+      if (deleteParts) {
+        delete tf.parts[i];
+      }
+      tf.parts[i] = nullptr;
+    }
+  }
+
+  for (auto& word : tf.arrived) {
+    word = 0;
+  }
+
+  tf.numParts = 0;
+  tf.inUse = false;
+  --fSize;
+}
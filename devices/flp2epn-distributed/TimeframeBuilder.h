@@ -0,0 +1,185 @@
+/**
+ * TimeframeBuilder.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef ALICEO2_DEVICES_TIMEFRAMEBUILDER_H_
+#define ALICEO2_DEVICES_TIMEFRAMEBUILDER_H_
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+#include "FairMQMessage.h"
+
+namespace AliceO2 {
+namespace Devices {
+
+/// Container for (sub-)timeframes
+
+struct TFBuffer
+{
+  std::vector<FairMQMessage*> parts; ///< Received parts, indexed by flpIndex, preallocated to the number of flpSenders
+  std::vector<uint64_t> arrived; ///< Arrival bitmap, bit n is set when the part from flpSender n has been received
+  int numParts; ///< Number of parts received so far (population count of the arrival bitmap)
+  uint64_t id; ///< ID of the timeframe occupying the slot
+  bool inUse; ///< true if the slot holds a (partial) timeframe
+  bool used; ///< true once the slot has held a timeframe, its ID stays valid after the release
+  uint32_t generation; ///< Incremented every time the slot is occupied, identifies stale deadlines
+  std::chrono::steady_clock::time_point startTime;
+  std::chrono::steady_clock::time_point endTime;
+};
+
+/// Fixed-window ring of timeframe slots
+///
+/// Timeframe with a given ID is assembled in slot (timeframeId % window). All slots and their part
+/// containers are allocated once in Init(), so buffering a timeframe does not touch the heap.
+/// Parts are stored in the order of the flpSender index, arrivals are tracked in a per-flpSender bitmap.
+/// Slot lookup, insertion of a part, duplicate detection and the completion check are O(1).
+/// Since an epnReceiver sees only every numEPNs-th ID, the window should be coprime with the number of epnReceivers.
+///
+/// All timeframes have the same timeout, so deadlines are queued in the order the timeframes are opened
+/// and the queue is deadline-ordered. Completed timeframes leave stale entries that are skipped
+/// when they reach the front, so finding the expired timeframes costs O(expired) instead of a scan of the ring.
+/// The deadline queue is a fixed ring of twice the window, stale entries are removed from it when it is full.
+
+class TimeframeBuilder
+{
+  public:
+    /// Outcome of adding a part to a timeframe
+    enum AddResult {
+      PartAdded, ///< Part stored, timeframe still incomplete
+      TimeframeComplete, ///< Part stored, parts from all flpSenders are present
+      DuplicatePart, ///< Part from this flpSender is already present, part not stored
+      InvalidIndex ///< flpSender index out of range, part not stored
+    };
+
+    /// Default constructor
+    TimeframeBuilder();
+    /// Default destructor, deletes parts of the timeframes still in the buffer
+    ~TimeframeBuilder();
+
+    /// Allocates the slots
+    /// @param numParts     Number of parts in a complete timeframe (number of flpSenders)
+    /// @param window       Number of slots in the ring
+    /// @param timeoutInMs  Time after which an incomplete timeframe expires
+    void Init(int numParts, int window, int timeoutInMs);
+
+    /// Returns the slot for the given timeframe ID. The slot may be free or occupied by another timeframe.
+    TFBuffer& Slot(uint64_t id) { return fSlots[id % fWindow]; }
+
+    /// Returns the buffered timeframe with the given ID, or nullptr if it is not in the buffer
+    TFBuffer* Find(uint64_t id)
+    {
+      TFBuffer& tf = Slot(id);
+      return (tf.inUse && tf.id == id) ? &tf : nullptr;
+    }
+
+    /// Checks if the timeframe with the given ID has already left the buffer (completed, expired or discarded)
+    /// or is older than the one occupying its slot. IDs do not wrap, so the order of IDs is the order of the timeframes.
+    bool IsPast(uint64_t id)
+    {
+      const TFBuffer& tf = Slot(id);
+      return tf.used && (id < tf.id || (id == tf.id && !tf.inUse));
+    }
+
+    /// Occupies a free slot with a new timeframe
+    /// @param tf   Free slot, as returned by Slot()
+    /// @param id   Timeframe ID
+    /// @param now  Arrival time of the first part (monotonic)
+    void Open(TFBuffer& tf, uint64_t id, const std::chrono::steady_clock::time_point& now)
+    {
+      tf.id = id;
+      tf.inUse = true;
+      tf.used = true;
+      tf.numParts = 0;
+      tf.startTime = now;
+      ++fSize;
+      if (fNumDeadlines == fDeadlines.size()) {
+        CompactDeadlines();
+      }
+      fDeadlines[(fDeadlineHead + fNumDeadlines) % fDeadlines.size()] = Deadline{now + fTimeout, static_cast<int>(&tf - fSlots.data()), ++tf.generation};
+      ++fNumDeadlines;
+    }
+
+    /// Adds a part to an occupied slot. Ownership of the part is taken only if it is stored.
+    /// @param tf       Occupied slot
+    /// @param flpIndex Index of the flpSender that sent the part
+    /// @param part     Sub-timeframe body
+    /// @return         Outcome, see AddResult
+    AddResult Add(TFBuffer& tf, int flpIndex, FairMQMessage* part)
+    {
+      if (flpIndex < 0 || flpIndex >= fNumParts) {
+        return InvalidIndex;
+      }
+
+      uint64_t& word = tf.arrived[flpIndex >> 6];
+      const uint64_t bit = uint64_t(1) << (flpIndex & 63);
+
+      if (word & bit) {
+        return DuplicatePart;
+      }
+
+      word |= bit;
+      tf.parts[flpIndex] = part;
+
+      return (++tf.numParts == fNumParts) ? TimeframeComplete : PartAdded;
+    }
+
+    /// Checks if the part from the given flpSender has arrived
+    bool HasPart(const TFBuffer& tf, int flpIndex) const
+    {
+      return (tf.arrived[flpIndex >> 6] >> (flpIndex & 63)) & 1;
+    }
+
+    /// Returns the next timeframe that is incomplete past its deadline, or nullptr if there is none.
+    /// The returned timeframe is still in the buffer, caller is expected to release it.
+    /// @param now  Current time (monotonic)
+    TFBuffer* NextExpired(const std::chrono::steady_clock::time_point& now);
+
+    /// Frees the slot
+    /// @param tf           Occupied slot
+    /// @param deleteParts  Delete the stored parts (false if the ownership was passed on, e.g. to the transport)
+    void Release(TFBuffer& tf, bool deleteParts);
+
+    /// Number of timeframes in the buffer
+    int Size() const { return fSize; }
+    /// Number of slots in the ring
+    int Window() const { return fWindow; }
+    /// Number of parts in a complete timeframe
+    int NumParts() const { return fNumParts; }
+
+    /// Access to all slots (for scanning and printing)
+    std::vector<TFBuffer>& Slots() { return fSlots; }
+    const std::vector<TFBuffer>& Slots() const { return fSlots; }
+
+  private:
+    /// Expiry time of an opened timeframe
+    struct Deadline
+    {
+      std::chrono::steady_clock::time_point time; ///< Time after which the timeframe expires
+      int slot; ///< Index of the slot in the ring
+      uint32_t generation; ///< Generation of the slot when the timeframe was opened
+    };
+
+    /// Removes the stale entries from the deadline queue, leaving at most one per occupied slot
+    void CompactDeadlines();
+    /// Checks if the deadline belongs to the timeframe occupying its slot
+    bool IsLive(const Deadline& d) const { return fSlots[d.slot].inUse && fSlots[d.slot].generation == d.generation; }
+
+    std::vector<TFBuffer> fSlots; ///< Ring of timeframe slots
+    std::vector<Deadline> fDeadlines; ///< Ring of the deadlines of opened timeframes, in the order of opening
+    size_t fDeadlineHead; ///< Index of the earliest deadline in fDeadlines
+    size_t fNumDeadlines; ///< Number of queued deadlines, including stale ones
+    std::chrono::steady_clock::duration fTimeout; ///< Time after which an incomplete timeframe expires
+    int fNumParts; ///< Number of parts in a complete timeframe
+    int fWindow; ///< Number of slots in the ring
+    int fSize; ///< Number of occupied slots
+};
+
+} // namespace Devices
+} // namespace AliceO2
+
+#endif
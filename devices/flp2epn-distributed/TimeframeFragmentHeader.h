@@ -0,0 +1,46 @@
+/**
+ * TimeframeFragmentHeader.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef ALICEO2_DEVICES_TIMEFRAMEFRAGMENTHEADER_H_
+#define ALICEO2_DEVICES_TIMEFRAMEFRAGMENTHEADER_H_
+
+#include <cstdint>
+
+namespace AliceO2 {
+namespace Devices {
+
+/// Header sent by the epnReceivers in front of the parts of an incomplete timeframe or of a late part
+///
+/// Complete timeframes are sent without it: the multipart message contains only the parts, ordered by flpIndex.
+/// Incomplete timeframes (forwarded after the buffer timeout) and late parts (arriving after their timeframe
+/// was forwarded or discarded) are sent as [header][parts...] and can be told apart by the magic number.
+/// In the header message the struct is followed by numMissing uint16 indices of the flpSenders whose parts are missing.
+/// The parts after the header are the available ones, ordered by flpIndex (a late fragment has exactly one).
+
+struct TimeframeFragmentHeader
+{
+  /// Kind of fragment
+  enum Types {
+    IncompleteTimeframe = 1, ///< Timeframe forwarded without the parts of the missing flpSenders
+    LateFragment = 2 ///< Single part that arrived after its timeframe left the epnReceiver
+  };
+
+  static const uint32_t MagicNumber = 0x4f325446; ///< "O2TF"
+
+  uint32_t magic; ///< MagicNumber
+  uint16_t type; ///< Kind of fragment, see Types
+  uint16_t numFLPs; ///< Number of parts in a complete timeframe
+  uint16_t flpIndex; ///< Index of the flpSender of a late fragment (0 for incomplete timeframes)
+  uint16_t reserved; ///< Padding, set to 0
+  uint32_t numMissing; ///< Number of missing flpSender indices following the struct
+  uint64_t timeframeId; ///< Timeframe ID
+};
+
+} // namespace Devices
+} // namespace AliceO2
+
+#endif
@@ -13,6 +13,7 @@
 #include "FairMQTransportFactoryZMQ.h"
 
 #include "EPNReceiver.h"
+#include "DevicePlacement.h"
 
 using namespace std;
 using namespace AliceO2::Devices;
@@ -21,8 +22,24 @@ typedef struct DeviceOptions
 {
   string id;
   int ioThreads;
+  string deviceCPUs;
+  string ioCPUs;
+  int numaNode;
+  string numaNIC;
   int heartbeatIntervalInMs;
   int bufferTimeoutInMs;
+  int bufferWindow;
+  int dispatchQueueSize;
+  int sendHeartbeats;
+  int creditLead;
+  string idInAddress;
+  string incompletePolicy;
+  int forwardLateParts;
+  string metricsFile;
+  int metricsIntervalInMs;
+  string metricsAddress;
+  string shmSegmentName;
+  int shmSegmentSize;
   int numFLPs;
   int testMode;
 
@@ -31,6 +48,7 @@ typedef struct DeviceOptions
   string dataInMethod;
   string dataInAddress;
   int dataInRateLogging;
+  string dataInTransport;
 
   string dataOutSocketType;
   int dataOutBufSize;
@@ -61,8 +79,24 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
   desc.add_options()
     ("id", bpo::value<string>()->required(), "Device ID")
     ("io-threads", bpo::value<int>()->default_value(1), "Number of I/O threads")
+    ("device-cpus", bpo::value<string>()->default_value(""), "CPUs for the device threads, e.g.: \"0-7,16-23\" (empty - not pinned)")
+    ("io-cpus", bpo::value<string>()->default_value(""), "CPUs for the transport I/O threads, e.g.: \"8,9\" (empty - not pinned)")
+    ("numa-node", bpo::value<int>()->default_value(-1), "NUMA node for the message buffers (-1 - the node of --numa-nic, if given)")
+    ("numa-nic", bpo::value<string>()->default_value(""), "Network interface whose NUMA node gets the message buffers, e.g.: \"ib0\" (empty - default placement)")
     ("heartbeat-interval", bpo::value<int>()->default_value(5000), "Heartbeat interval in milliseconds")
     ("buffer-timeout", bpo::value<int>()->default_value(1000), "Buffer timeout in milliseconds")
+    ("buffer-window", bpo::value<int>()->default_value(1021), "Number of timeframe slots in the buffer (should be coprime with the number of EPNs)")
+    ("dispatch-queue-size", bpo::value<int>()->default_value(0), "Depth of the queue between receive and dispatch threads, 0 to receive and dispatch in one thread")
+    ("send-heartbeats", bpo::value<int>()->default_value(1), "Send heartbeats with buffer credits to the FLPs, 1/0 (required for liveness checks and credit-based EPN selection)")
+    ("credit-lead", bpo::value<int>()->default_value(256), "Number of timeframe IDs after the current one (last published on --id-in-address, or else last received) from which advertised credits apply")
+    ("id-in-address", bpo::value<string>()->default_value(""), "Address of the timeframe IDs (flpSyncSampler --data-out-address) to connect to, for stamping the credits, e.g.: \"tcp://localhost:5550\" (empty - none)")
+    ("incomplete-policy", bpo::value<string>()->default_value("discard"), "Handling of timeframes incomplete after the buffer timeout: discard/forward (with a header listing the missing FLPs)")
+    ("forward-late-parts", bpo::value<int>()->default_value(0), "Forward parts arriving after their timeframe was discarded or forwarded as single fragments, 1/0")
+    ("metrics-file", bpo::value<string>()->default_value(""), "File the device metrics are appended to as JSON lines (empty - none)")
+    ("metrics-interval", bpo::value<int>()->default_value(1000), "Interval for publishing the device metrics in milliseconds")
+    ("metrics-address", bpo::value<string>()->default_value(""), "Address of a pub socket publishing the device metrics, e.g.: \"tcp://*:5580\" (empty - none)")
+    ("shm-segment-name", bpo::value<string>()->default_value("flp2epn"), "Name of the shared memory segment for shm channels (shared by all devices on the host)")
+    ("shm-segment-size", bpo::value<int>()->default_value(1024), "Size of the shared memory segment in MB, if it is created")
     ("num-flps", bpo::value<int>()->required(), "Number of FLPs")
     ("test-mode", bpo::value<int>()->default_value(0), "Run in test mode")
 
@@ -71,6 +105,7 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
     ("data-in-method", bpo::value<string>()->default_value("bind"), "Data input method: bind/connect")
     ("data-in-address", bpo::value<string>()->required(), "Data input address, e.g.: \"tcp://localhost:5555\"")
     ("data-in-rate-logging", bpo::value<int>()->default_value(1), "Log input rate on data socket, 1/0")
+    ("data-in-transport", bpo::value<string>()->default_value("zmq"), "Data input transport: zmq/shm (descriptors of data in shared memory, for FLPs on the same host)")
 
     ("data-out-socket-type", bpo::value<string>()->default_value("push"), "Output socket type: pub/push")
     ("data-out-buff-size", bpo::value<int>()->default_value(10), "Output buffer size in number of messages (ZeroMQ)/bytes(nanomsg)")
@@ -104,8 +139,24 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
 
   if (vm.count("id"))                    { _options->id                    = vm["id"].as<string>(); }
   if (vm.count("io-threads"))            { _options->ioThreads             = vm["io-threads"].as<int>(); }
+  if (vm.count("device-cpus"))           { _options->deviceCPUs            = vm["device-cpus"].as<string>(); }
+  if (vm.count("io-cpus"))               { _options->ioCPUs                = vm["io-cpus"].as<string>(); }
+  if (vm.count("numa-node"))             { _options->numaNode              = vm["numa-node"].as<int>(); }
+  if (vm.count("numa-nic"))              { _options->numaNIC               = vm["numa-nic"].as<string>(); }
   if (vm.count("heartbeat-interval"))    { _options->heartbeatIntervalInMs = vm["heartbeat-interval"].as<int>(); }
   if (vm.count("buffer-timeout"))        { _options->bufferTimeoutInMs     = vm["buffer-timeout"].as<int>(); }
+  if (vm.count("buffer-window"))         { _options->bufferWindow          = vm["buffer-window"].as<int>(); }
+  if (vm.count("dispatch-queue-size"))   { _options->dispatchQueueSize     = vm["dispatch-queue-size"].as<int>(); }
+  if (vm.count("send-heartbeats"))       { _options->sendHeartbeats        = vm["send-heartbeats"].as<int>(); }
+  if (vm.count("credit-lead"))           { _options->creditLead            = vm["credit-lead"].as<int>(); }
+  if (vm.count("id-in-address"))         { _options->idInAddress           = vm["id-in-address"].as<string>(); }
+  if (vm.count("incomplete-policy"))     { _options->incompletePolicy      = vm["incomplete-policy"].as<string>(); }
+  if (vm.count("forward-late-parts"))    { _options->forwardLateParts      = vm["forward-late-parts"].as<int>(); }
+  if (vm.count("metrics-file"))          { _options->metricsFile           = vm["metrics-file"].as<string>(); }
+  if (vm.count("metrics-interval"))      { _options->metricsIntervalInMs   = vm["metrics-interval"].as<int>(); }
+  if (vm.count("metrics-address"))       { _options->metricsAddress        = vm["metrics-address"].as<string>(); }
+  if (vm.count("shm-segment-name"))      { _options->shmSegmentName        = vm["shm-segment-name"].as<string>(); }
+  if (vm.count("shm-segment-size"))      { _options->shmSegmentSize        = vm["shm-segment-size"].as<int>(); }
   if (vm.count("num-flps"))              { _options->numFLPs               = vm["num-flps"].as<int>(); }
   if (vm.count("test-mode"))             { _options->testMode              = vm["test-mode"].as<int>(); }
 
@@ -114,6 +165,7 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
   if (vm.count("data-in-method"))        { _options->dataInMethod          = vm["data-in-method"].as<string>(); }
   if (vm.count("data-in-address"))       { _options->dataInAddress         = vm["data-in-address"].as<string>(); }
   if (vm.count("data-in-rate-logging"))  { _options->dataInRateLogging     = vm["data-in-rate-logging"].as<int>(); }
+  if (vm.count("data-in-transport"))     { _options->dataInTransport       = vm["data-in-transport"].as<string>(); }
 
   if (vm.count("data-out-socket-type"))  { _options->dataOutSocketType     = vm["data-out-socket-type"].as<string>(); }
   if (vm.count("data-out-buff-size"))    { _options->dataOutBufSize        = vm["data-out-buff-size"].as<int>(); }
@@ -162,6 +214,15 @@ int main(int argc, char** argv)
 
   LOG(INFO) << "EPN Receiver, ID: " << options.id << " (PID: " << getpid() << ")";
 
+  // place the threads and the message buffers, before the device starts any of them
+  DevicePlacement placement;
+  if (!placement.Configure(options.deviceCPUs, options.ioCPUs, options.numaNode, options.numaNIC)) {
+    return 1;
+  }
+  placement.SetMemoryPolicy();
+  placement.PinIoThreads();
+  placement.Report();
+
   // configure the transport interface
   FairMQTransportFactory* transportFactory = new FairMQTransportFactoryZMQ();
   epn.SetTransport(transportFactory);
@@ -171,6 +232,17 @@ int main(int argc, char** argv)
   epn.SetProperty(EPNReceiver::NumIoThreads, options.ioThreads);
   epn.SetProperty(EPNReceiver::HeartbeatIntervalInMs, options.heartbeatIntervalInMs);
   epn.SetProperty(EPNReceiver::BufferTimeoutInMs, options.bufferTimeoutInMs);
+  epn.SetProperty(EPNReceiver::BufferWindow, options.bufferWindow);
+  epn.SetProperty(EPNReceiver::DispatchQueueSize, options.dispatchQueueSize);
+  epn.SetProperty(EPNReceiver::SendHeartbeats, options.sendHeartbeats);
+  epn.SetProperty(EPNReceiver::CreditLead, options.creditLead);
+  epn.SetProperty(EPNReceiver::IncompletePolicy, options.incompletePolicy);
+  epn.SetProperty(EPNReceiver::ForwardLateParts, options.forwardLateParts);
+  epn.SetProperty(EPNReceiver::MetricsFile, options.metricsFile);
+  epn.SetProperty(EPNReceiver::MetricsIntervalInMs, options.metricsIntervalInMs);
+  epn.SetProperty(EPNReceiver::DataInTransport, options.dataInTransport);
+  epn.SetProperty(EPNReceiver::ShmSegmentName, options.shmSegmentName);
+  epn.SetProperty(EPNReceiver::ShmSegmentSize, options.shmSegmentSize);
   epn.SetProperty(EPNReceiver::NumFLPs, options.numFLPs);
   epn.SetProperty(EPNReceiver::TestMode, options.testMode);
 
@@ -204,6 +276,18 @@ int main(int argc, char** argv)
   ackOutChannel.UpdateRateLogging(options.ackOutRateLogging);
   epn.fChannels["ack-out"].push_back(ackOutChannel);
 
+  // configure the optional timeframe ID input channel
+  if (!options.idInAddress.empty()) {
+    FairMQChannel idInChannel("sub", "connect", options.idInAddress);
+    epn.fChannels["id-in"].push_back(idInChannel);
+  }
+
+  // configure the optional metrics output channel
+  if (!options.metricsAddress.empty()) {
+    FairMQChannel metricsOutChannel("pub", "bind", options.metricsAddress);
+    epn.fChannels["metrics-out"].push_back(metricsOutChannel);
+  }
+
   // init the device
   epn.ChangeState("INIT_DEVICE");
   epn.WaitForEndOfState("INIT_DEVICE");
@@ -212,6 +296,9 @@ int main(int argc, char** argv)
   epn.ChangeState("INIT_TASK");
   epn.WaitForEndOfState("INIT_TASK");
 
+  // the device thread is started with the affinity of this thread, the I/O threads keep theirs.
+  placement.PinDeviceThreads();
+
   // run the device
   epn.ChangeState("RUN");
   epn.InteractiveStateLoop();
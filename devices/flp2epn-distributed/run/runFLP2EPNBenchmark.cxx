@@ -0,0 +1,360 @@
+/**
+ * runFLP2EPNBenchmark.cxx
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <memory> // unique_ptr
+#include <chrono>
+#include <thread> // this_thread::sleep_for
+
+#include <unistd.h> // getpid
+
+#include "boost/program_options.hpp"
+#include "boost/interprocess/shared_memory_object.hpp"
+
+#include "FairMQLogger.h"
+#include "FairMQTransportFactoryZMQ.h"
+
+#include "FLPSyncSampler.h"
+#include "FLPSender.h"
+#include "EPNReceiver.h"
+#include "Codec.h"
+
+using namespace std;
+using namespace AliceO2::Devices;
+
+typedef struct DeviceOptions
+{
+  vector<int> numFLPs;
+  vector<int> numEPNs;
+  vector<int> eventSize;
+  vector<int> eventRate;
+  int durationInS;
+  string transport;
+  string codec;
+  int bufSize;
+  int bufferTimeoutInMs;
+  int dispatchQueueSize;
+  string outputCSV;
+} DeviceOptions_t;
+
+/// Configuration of one point of the sweep
+struct BenchmarkPoint
+{
+  int numFLPs;
+  int numEPNs;
+  int eventSize;
+  int eventRate;
+};
+
+/// Measurements of one point of the sweep
+struct BenchmarkResult
+{
+  unsigned long published; ///< Timeframe IDs published by the flpSyncSampler
+  uint64_t completed; ///< Timeframes acknowledged by the epnReceivers
+  unsigned long discarded; ///< Incomplete timeframes discarded by the epnReceivers
+  double durationInS; ///< Measured publishing time
+  uint64_t p50; ///< Timeframe completion latency percentiles in microseconds
+  uint64_t p99;
+  uint64_t p999;
+  uint64_t max;
+};
+
+inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
+{
+  if (_options == NULL)
+    throw runtime_error("Internal error: options' container is empty.");
+
+  namespace bpo = boost::program_options;
+  bpo::options_description desc("Options");
+  desc.add_options()
+    ("num-flps", bpo::value<vector<int>>()->multitoken()->default_value(vector<int>{2}, "2"), "Number of FLPs (several values to sweep)")
+    ("num-epns", bpo::value<vector<int>>()->multitoken()->default_value(vector<int>{2}, "2"), "Number of EPNs (several values to sweep)")
+    ("event-size", bpo::value<vector<int>>()->multitoken()->default_value(vector<int>{1000000}, "1000000"), "Sub-timeframe size in bytes (several values to sweep)")
+    ("event-rate", bpo::value<vector<int>>()->multitoken()->default_value(vector<int>{100}, "100"), "Timeframe rate in Hz, 0 - unlimited (several values to sweep)")
+    ("duration", bpo::value<int>()->default_value(10), "Measurement time per configuration in seconds")
+    ("transport", bpo::value<string>()->default_value("inproc"), "Transport between the devices: inproc/ipc/shm (ipc with the FLP-EPN data in shared memory)")
+    ("codec", bpo::value<string>()->default_value("none"), "Codec between FLPs and EPNs: none/lz/shuffle-huffman")
+    ("buff-size", bpo::value<int>()->default_value(10), "Buffer size of the data channels in number of messages")
+    ("buffer-timeout", bpo::value<int>()->default_value(1000), "Buffer timeout of the EPNs in milliseconds")
+    ("dispatch-queue-size", bpo::value<int>()->default_value(0), "Dispatch queue size of the EPNs, 0 to receive and dispatch in one thread")
+    ("output-csv", bpo::value<string>()->default_value(""), "Write the results also as CSV to this file")
+    ("help", "Print help messages");
+
+  bpo::variables_map vm;
+  bpo::store(bpo::parse_command_line(_argc, _argv, desc), vm);
+
+  if (vm.count("help")) {
+    LOG(INFO) << "FLP2EPN Benchmark" << endl << desc;
+    return false;
+  }
+
+  bpo::notify(vm);
+
+  if (vm.count("num-flps"))            { _options->numFLPs           = vm["num-flps"].as<vector<int>>(); }
+  if (vm.count("num-epns"))            { _options->numEPNs           = vm["num-epns"].as<vector<int>>(); }
+  if (vm.count("event-size"))          { _options->eventSize         = vm["event-size"].as<vector<int>>(); }
+  if (vm.count("event-rate"))          { _options->eventRate         = vm["event-rate"].as<vector<int>>(); }
+  if (vm.count("duration"))            { _options->durationInS       = vm["duration"].as<int>(); }
+  if (vm.count("transport"))           { _options->transport         = vm["transport"].as<string>(); }
+  if (vm.count("codec"))               { _options->codec             = vm["codec"].as<string>(); }
+  if (vm.count("buff-size"))           { _options->bufSize           = vm["buff-size"].as<int>(); }
+  if (vm.count("buffer-timeout"))      { _options->bufferTimeoutInMs = vm["buffer-timeout"].as<int>(); }
+  if (vm.count("dispatch-queue-size")) { _options->dispatchQueueSize = vm["dispatch-queue-size"].as<int>(); }
+  if (vm.count("output-csv"))          { _options->outputCSV         = vm["output-csv"].as<string>(); }
+
+  return true;
+}
+
+/// Creates a channel without rate logging
+static FairMQChannel makeChannel(const string& type, const string& method, const string& address, int bufSize)
+{
+  FairMQChannel channel(type, method, address);
+  channel.UpdateSndBufSize(bufSize);
+  channel.UpdateRcvBufSize(bufSize);
+  channel.UpdateRateLogging(0);
+  return channel;
+}
+
+/// Initializes a device and its task
+static void initDevice(FairMQDevice& device)
+{
+  device.ChangeState("INIT_DEVICE");
+  device.WaitForEndOfState("INIT_DEVICE");
+
+  device.ChangeState("INIT_TASK");
+  device.WaitForEndOfState("INIT_TASK");
+}
+
+/// Stops a running device and brings it to the end state
+static void stopDevice(FairMQDevice& device)
+{
+  device.ChangeState("STOP");
+  device.WaitForEndOfState("RUN");
+
+  device.ChangeState("RESET_TASK");
+  device.WaitForEndOfState("RESET_TASK");
+
+  device.ChangeState("RESET_DEVICE");
+  device.WaitForEndOfState("RESET_DEVICE");
+
+  device.ChangeState("END");
+}
+
+/// Name of the shared memory segment of this benchmark process (shm transport)
+static string shmSegmentName()
+{
+  return "flp2epn-benchmark-" + to_string(getpid());
+}
+
+/// Runs one configuration: flpSyncSampler, N flpSenders and M epnReceivers in test mode, in this process
+static BenchmarkResult runPoint(const DeviceOptions_t& options, const BenchmarkPoint& point, int pointIndex)
+{
+  // unique addresses for every point, so that endpoints of the previous one cannot interfere.
+  stringstream prefix;
+  if (options.transport == "ipc" || options.transport == "shm") {
+    prefix << "ipc:///tmp/flp2epn-benchmark-" << getpid() << "-" << pointIndex << "-";
+  } else {
+    prefix << "inproc://flp2epn-benchmark-" << pointIndex << "-";
+  }
+  string samplerOutAddress = prefix.str() + "sampler-out";
+  string ackAddress = prefix.str() + "ack";
+
+  FLPSyncSampler sampler;
+  sampler.SetTransport(new FairMQTransportFactoryZMQ());
+  sampler.SetProperty(FLPSyncSampler::Id, "benchmark-sampler");
+  sampler.SetProperty(FLPSyncSampler::EventRate, point.eventRate);
+  // only the total is of interest.
+  sampler.SetProperty(FLPSyncSampler::RTTReportInterval, options.durationInS + 60);
+  sampler.fChannels["data-out"].push_back(makeChannel("pub", "bind", samplerOutAddress, 100));
+  sampler.fChannels["ack-in"].push_back(makeChannel("pull", "bind", ackAddress, 100));
+
+  vector<unique_ptr<FLPSender>> flps;
+  for (int i = 0; i < point.numFLPs; ++i) {
+    flps.emplace_back(new FLPSender());
+    FLPSender& flp = *flps.back();
+    flp.SetTransport(new FairMQTransportFactoryZMQ());
+    flp.SetProperty(FLPSender::Id, "benchmark-flp-" + to_string(i));
+    flp.SetProperty(FLPSender::Index, i);
+    flp.SetProperty(FLPSender::EventSize, point.eventSize);
+    flp.SetProperty(FLPSender::TestMode, 1);
+    flp.SetProperty(FLPSender::SendOffset, 0);
+    flp.SetProperty(FLPSender::DataOutCodec, options.codec);
+    if (options.transport == "shm") {
+      flp.SetProperty(FLPSender::DataOutTransport, "shm");
+      flp.SetProperty(FLPSender::ShmSegmentName, shmSegmentName());
+    }
+    flp.fChannels["data-in"].push_back(makeChannel("sub", "connect", samplerOutAddress, 100));
+    for (int j = 0; j < point.numEPNs; ++j) {
+      flp.fChannels["data-out"].push_back(makeChannel("push", "connect", prefix.str() + "epn-in-" + to_string(j), options.bufSize));
+    }
+    flp.fChannels["heartbeat-in"].push_back(makeChannel("sub", "bind", prefix.str() + "flp-hb-" + to_string(i), 100));
+  }
+
+  vector<unique_ptr<EPNReceiver>> epns;
+  for (int j = 0; j < point.numEPNs; ++j) {
+    epns.emplace_back(new EPNReceiver());
+    EPNReceiver& epn = *epns.back();
+    epn.SetTransport(new FairMQTransportFactoryZMQ());
+    epn.SetProperty(EPNReceiver::Id, "benchmark-epn-" + to_string(j));
+    epn.SetProperty(EPNReceiver::NumFLPs, point.numFLPs);
+    epn.SetProperty(EPNReceiver::TestMode, 1);
+    epn.SetProperty(EPNReceiver::BufferTimeoutInMs, options.bufferTimeoutInMs);
+    epn.SetProperty(EPNReceiver::DispatchQueueSize, options.dispatchQueueSize);
+    if (options.transport == "shm") {
+      epn.SetProperty(EPNReceiver::DataInTransport, "shm");
+      epn.SetProperty(EPNReceiver::ShmSegmentName, shmSegmentName());
+    }
+    epn.fChannels["data-in"].push_back(makeChannel("pull", "bind", prefix.str() + "epn-in-" + to_string(j), options.bufSize));
+    // no receiver for the built timeframes, pub discards them.
+    epn.fChannels["data-out"].push_back(makeChannel("pub", "bind", prefix.str() + "epn-out-" + to_string(j), options.bufSize));
+    for (int i = 0; i < point.numFLPs; ++i) {
+      epn.fChannels["heartbeat-out"].push_back(makeChannel("pub", "connect", prefix.str() + "flp-hb-" + to_string(i), 100));
+    }
+    epn.fChannels["ack-out"].push_back(makeChannel("push", "connect", ackAddress, 100));
+  }
+
+  // binding devices first.
+  initDevice(sampler);
+  for (auto& epn : epns) {
+    initDevice(*epn);
+  }
+  for (auto& flp : flps) {
+    initDevice(*flp);
+  }
+
+  for (auto& epn : epns) {
+    epn->ChangeState("RUN");
+  }
+  for (auto& flp : flps) {
+    flp->ChangeState("RUN");
+  }
+
+  // give the subscriptions time to propagate, IDs published before would be lost.
+  this_thread::sleep_for(chrono::milliseconds(500));
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  sampler.ChangeState("RUN");
+  this_thread::sleep_for(chrono::seconds(options.durationInS));
+  stopDevice(sampler);
+  chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+  for (auto& flp : flps) {
+    stopDevice(*flp);
+  }
+  for (auto& epn : epns) {
+    stopDevice(*epn);
+  }
+
+  BenchmarkResult result;
+  const LatencyHistogram& rtt = sampler.TotalRTT();
+  result.published = sampler.NumPublished();
+  result.completed = rtt.Count();
+  result.discarded = 0;
+  for (auto& epn : epns) {
+    result.discarded += epn->NumDiscarded();
+  }
+  result.durationInS = chrono::duration<double>(end - start).count();
+  result.p50 = rtt.Percentile(0.5);
+  result.p99 = rtt.Percentile(0.99);
+  result.p999 = rtt.Percentile(0.999);
+  result.max = rtt.Max();
+
+  return result;
+}
+
+int main(int argc, char** argv)
+{
+  // container for the command line options
+  DeviceOptions_t options;
+  // parse the command line options and fill the container
+  try {
+    if (!parse_cmd_line(argc, argv, &options)) {
+      return 0;
+    }
+  } catch (const exception& e) {
+    LOG(ERROR) << e.what();
+    return 1;
+  }
+
+  if (options.transport != "inproc" && options.transport != "ipc" && options.transport != "shm") {
+    LOG(ERROR) << "Unknown transport \"" << options.transport << "\", use inproc, ipc or shm.";
+    return 1;
+  }
+
+  if (Codec::FromName(options.codec) < 0) {
+    LOG(ERROR) << "Unknown codec \"" << options.codec << "\", use none, lz or shuffle-huffman.";
+    return 1;
+  }
+
+  vector<BenchmarkPoint> points;
+  for (int numFLPs : options.numFLPs) {
+    for (int numEPNs : options.numEPNs) {
+      for (int eventSize : options.eventSize) {
+        for (int eventRate : options.eventRate) {
+          points.push_back(BenchmarkPoint{numFLPs, numEPNs, eventSize, eventRate});
+        }
+      }
+    }
+  }
+
+  ofstream csv;
+  if (!options.outputCSV.empty()) {
+    csv.open(options.outputCSV);
+    csv << "flps,epns,event_size,event_rate,published,completed,lost,discarded,tf_per_s,mb_per_s,p50_us,p99_us,p999_us,max_us\n";
+  }
+
+  stringstream table;
+  table << setw(5) << "FLPs" << setw(5) << "EPNs" << setw(11) << "size [B]" << setw(10) << "rate [Hz]"
+        << setw(11) << "published" << setw(11) << "completed" << setw(8) << "lost" << setw(10) << "discarded"
+        << setw(10) << "TF/s" << setw(10) << "MB/s" << setw(10) << "p50 [μs]" << setw(10) << "p99 [μs]"
+        << setw(11) << "p99.9 [μs]" << setw(10) << "max [μs]" << "\n";
+
+  int status = 0;
+
+  for (size_t i = 0; i < points.size(); ++i) {
+    const BenchmarkPoint& point = points[i];
+    LOG(INFO) << "Benchmark " << i + 1 << "/" << points.size() << ": " << point.numFLPs << " FLPs, " << point.numEPNs
+              << " EPNs, " << point.eventSize << " bytes, " << point.eventRate << " Hz";
+
+    BenchmarkResult result = runPoint(options, point, i);
+
+    if (result.completed == 0) {
+      // nothing got through the chain, which makes the run fail (e.g. as a smoke test).
+      LOG(ERROR) << "No timeframe completed in benchmark " << i + 1 << "/" << points.size();
+      status = 1;
+    }
+
+    // timeframes still in flight when the sampler stops are counted as lost.
+    long lost = static_cast<long>(result.published) - static_cast<long>(result.completed);
+    double tfRate = result.completed / result.durationInS;
+    double mbRate = tfRate * point.numFLPs * point.eventSize / 1000000.;
+
+    table << setw(5) << point.numFLPs << setw(5) << point.numEPNs << setw(11) << point.eventSize << setw(10) << point.eventRate
+          << setw(11) << result.published << setw(11) << result.completed << setw(8) << lost << setw(10) << result.discarded
+          << setw(10) << fixed << setprecision(1) << tfRate << setw(10) << mbRate
+          << setw(10) << result.p50 << setw(10) << result.p99 << setw(11) << result.p999 << setw(10) << result.max << "\n";
+
+    if (csv.is_open()) {
+      csv << point.numFLPs << "," << point.numEPNs << "," << point.eventSize << "," << point.eventRate << ","
+          << result.published << "," << result.completed << "," << lost << "," << result.discarded << ","
+          << fixed << setprecision(1) << tfRate << "," << mbRate << ","
+          << result.p50 << "," << result.p99 << "," << result.p999 << "," << result.max << "\n";
+    }
+  }
+
+  cout << table.str();
+
+  if (options.transport == "shm") {
+    // the devices leave the segment in place for others on the host, here it has no further users.
+    boost::interprocess::shared_memory_object::remove(shmSegmentName().c_str());
+  }
+
+  return status;
+}
@@ -21,6 +21,13 @@ typedef struct DeviceOptions
 {
   string id;
   int eventRate;
+  int burstSize;
+  string arrivalMode;
+  int rttReportInterval;
+  string rttDumpFile;
+  string membershipFile;
+  int membershipLead;
+  string membershipOutAddress;
   int ioThreads;
 
   string dataOutSocketType;
@@ -45,7 +52,14 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
   bpo::options_description desc("Options");
   desc.add_options()
     ("id", bpo::value<string>()->required(), "Device ID")
-    ("event-rate", bpo::value<int>()->default_value(0), "Event rate limit in maximum number of events per second")
+    ("event-rate", bpo::value<int>()->default_value(0), "Event rate limit in maximum number of events per second (0 - unlimited)")
+    ("burst-size", bpo::value<int>()->default_value(1), "Number of events published back-to-back, the interval between bursts keeps the event rate")
+    ("arrival-mode", bpo::value<string>()->default_value("fixed"), "Distribution of the intervals between bursts: fixed/poisson")
+    ("rtt-report-interval", bpo::value<int>()->default_value(10), "Interval in seconds between the roundtrip time summaries")
+    ("rtt-dump-file", bpo::value<string>()->default_value(""), "File to append binary roundtrip time histograms to (empty - no dump)")
+    ("membership-file", bpo::value<string>()->default_value(""), "File with the data input addresses of the EPNs that get timeframes, read every 500 ms (empty - all EPNs)")
+    ("membership-lead", bpo::value<int>()->default_value(1000), "Number of timeframe IDs between publishing a membership change and its application")
+    ("membership-out-address", bpo::value<string>()->default_value(""), "Address of a pub socket publishing the membership to the FLPs, e.g.: \"tcp://*:5590\" (empty - none)")
     ("io-threads", bpo::value<int>()->default_value(1), "Number of I/O threads")
 
     ("data-out-socket-type", bpo::value<string>()->default_value("pub"), "Data output socket type: pub/push")
@@ -74,6 +88,13 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
 
   if (vm.count("id"))                       { _options->id                = vm["id"].as<string>(); }
   if (vm.count("event-rate"))               { _options->eventRate         = vm["event-rate"].as<int>(); }
+  if (vm.count("burst-size"))               { _options->burstSize         = vm["burst-size"].as<int>(); }
+  if (vm.count("arrival-mode"))             { _options->arrivalMode       = vm["arrival-mode"].as<string>(); }
+  if (vm.count("rtt-report-interval"))      { _options->rttReportInterval = vm["rtt-report-interval"].as<int>(); }
+  if (vm.count("rtt-dump-file"))            { _options->rttDumpFile       = vm["rtt-dump-file"].as<string>(); }
+  if (vm.count("membership-file"))          { _options->membershipFile    = vm["membership-file"].as<string>(); }
+  if (vm.count("membership-lead"))          { _options->membershipLead    = vm["membership-lead"].as<int>(); }
+  if (vm.count("membership-out-address"))   { _options->membershipOutAddress = vm["membership-out-address"].as<string>(); }
   if (vm.count("io-threads"))               { _options->ioThreads         = vm["io-threads"].as<int>(); }
 
   if (vm.count("data-out-socket-type"))  { _options->dataOutSocketType  = vm["data-out-socket-type"].as<string>(); }
@@ -119,6 +140,12 @@ int main(int argc, char** argv)
   sampler.SetProperty(FLPSyncSampler::Id, options.id);
   sampler.SetProperty(FLPSyncSampler::NumIoThreads, options.ioThreads);
   sampler.SetProperty(FLPSyncSampler::EventRate, options.eventRate);
+  sampler.SetProperty(FLPSyncSampler::BurstSize, options.burstSize);
+  sampler.SetProperty(FLPSyncSampler::ArrivalMode, options.arrivalMode);
+  sampler.SetProperty(FLPSyncSampler::RTTReportInterval, options.rttReportInterval);
+  sampler.SetProperty(FLPSyncSampler::RTTDumpFile, options.rttDumpFile);
+  sampler.SetProperty(FLPSyncSampler::MembershipFile, options.membershipFile);
+  sampler.SetProperty(FLPSyncSampler::MembershipLead, options.membershipLead);
 
   // configure data output channel
   FairMQChannel dataOutChannel(options.dataOutSocketType, options.dataOutMethod, options.dataOutAddress);
@@ -134,6 +161,12 @@ int main(int argc, char** argv)
   ackInChannel.UpdateRateLogging(options.ackInRateLogging);
   sampler.fChannels["ack-in"].push_back(ackInChannel);
 
+  // configure the optional membership output channel
+  if (!options.membershipOutAddress.empty()) {
+    FairMQChannel membershipOutChannel("pub", "bind", options.membershipOutAddress);
+    sampler.fChannels["membership-out"].push_back(membershipOutChannel);
+  }
+
   // init the device
   sampler.ChangeState("INIT_DEVICE");
   sampler.WaitForEndOfState("INIT_DEVICE");
@@ -19,6 +19,7 @@
 #include "FairMQTools.h"
 
 #include "FLPSender.h"
+#include "DevicePlacement.h"
 
 #include "KeyValue.h" // DDS
 
@@ -31,11 +32,31 @@ typedef struct DeviceOptions
   int flpIndex;
   int eventSize;
   int ioThreads;
+  string deviceCPUs;
+  string ioCPUs;
+  int numaNode;
+  string numaNIC;
   int numEPNs;
   int heartbeatTimeoutInMs;
   int testMode;
   int sendOffset;
   int sendDelay;
+  string epnSelection;
+  string deadEPNPolicy;
+  int holdLimit;
+  int bufferSize;
+  int sendRate;
+  int sendBurst;
+  int outputQueueSize;
+  string overflowPolicy;
+  string metricsFile;
+  int metricsIntervalInMs;
+  string metricsAddress;
+  string membershipInAddress;
+  string shmSegmentName;
+  int shmSegmentSize;
+  int codecElementSize;
+  int compressionThreads;
 
   string dataInSocketType;
   int dataInBufSize;
@@ -48,6 +69,8 @@ typedef struct DeviceOptions
   string dataOutMethod;
   // vector<string> dataOutAddress;
   int dataOutRateLogging;
+  vector<string> dataOutTransport;
+  vector<string> dataOutCodec;
 
   string hbInSocketType;
   int hbInBufSize;
@@ -68,11 +91,31 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
     ("flp-index", bpo::value<int>()->default_value(0), "FLP Index (for debugging in test mode)")
     ("event-size", bpo::value<int>()->default_value(1000), "Event size in bytes (test mode)")
     ("io-threads", bpo::value<int>()->default_value(1), "Number of I/O threads")
+    ("device-cpus", bpo::value<string>()->default_value(""), "CPUs for the device threads, e.g.: \"0-7,16-23\" (empty - not pinned)")
+    ("io-cpus", bpo::value<string>()->default_value(""), "CPUs for the transport I/O threads, e.g.: \"8,9\" (empty - not pinned)")
+    ("numa-node", bpo::value<int>()->default_value(-1), "NUMA node for the message buffers (-1 - the node of --numa-nic, if given)")
+    ("numa-nic", bpo::value<string>()->default_value(""), "Network interface whose NUMA node gets the message buffers, e.g.: \"ib0\" (empty - default placement)")
     ("num-epns", bpo::value<int>()->required(), "Number of EPNs")
     ("heartbeat-timeout", bpo::value<int>()->default_value(20000), "Heartbeat timeout in milliseconds")
     ("test-mode", bpo::value<int>()->default_value(0),"Run in test mode")
     ("send-offset", bpo::value<int>()->default_value(0), "Offset for staggered sending")
     ("send-delay", bpo::value<int>()->default_value(0), "Delay for staggered sending")
+    ("epn-selection", bpo::value<string>()->default_value("round-robin"), "Selection of the target EPN: round-robin/credit (credit requires EPNs with --send-heartbeats 1)")
+    ("dead-epn-policy", bpo::value<string>()->default_value("drop"), "Handling of sub-timeframes for EPNs without heartbeat within the timeout: off/drop/hold/reroute (reroute: FLPs can disagree near the timeout and split a timeframe)")
+    ("hold-limit", bpo::value<int>()->default_value(100), "Maximum number of held sub-timeframes per dead EPN (dead-epn-policy hold)")
+    ("buffer-size", bpo::value<int>()->default_value(1000), "Maximum number of buffered sub-timeframes")
+    ("send-rate", bpo::value<int>()->default_value(0), "Output bandwidth per EPN in MB/s (0 - unlimited)")
+    ("send-burst", bpo::value<int>()->default_value(0), "Number of bytes that can be sent to an EPN in a burst above the send rate")
+    ("output-queue-size", bpo::value<int>()->default_value(100), "Maximum number of queued sub-timeframes per EPN")
+    ("overflow-policy", bpo::value<string>()->default_value("block"), "Handling of a full output queue: block/drop-oldest/drop-newest")
+    ("metrics-file", bpo::value<string>()->default_value(""), "File the device metrics are appended to as JSON lines (empty - none)")
+    ("metrics-interval", bpo::value<int>()->default_value(1000), "Interval for publishing the device metrics in milliseconds")
+    ("metrics-address", bpo::value<string>()->default_value(""), "Address of a pub socket publishing the device metrics, e.g.: \"tcp://*:5580\" (empty - none)")
+    ("membership-in-address", bpo::value<string>()->default_value(""), "Address of the membership updates (flpSyncSampler --membership-out-address) to connect to, e.g.: \"tcp://localhost:5590\" (empty - all EPNs are members)")
+    ("shm-segment-name", bpo::value<string>()->default_value("flp2epn"), "Name of the shared memory segment for shm channels (shared by all devices on the host)")
+    ("shm-segment-size", bpo::value<int>()->default_value(1024), "Size of the shared memory segment in MB, if it is created")
+    ("codec-element-size", bpo::value<int>()->default_value(2), "Element size of the data in bytes, for the byte shuffle of the shuffle-huffman codec")
+    ("compression-threads", bpo::value<int>()->default_value(2), "Number of threads compressing the output")
 
     ("data-in-socket-type", bpo::value<string>()->default_value("pull"), "Data input socket type: sub/pull")
     ("data-in-buff-size", bpo::value<int>()->default_value(10), "Data input buffer size in number of messages (ZeroMQ)/bytes(nanomsg)")
@@ -85,6 +128,8 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
     ("data-out-method", bpo::value<string>()->default_value("connect"), "Output method: bind/connect")
     // ("data-out-address", bpo::value<vector<string>>()->required(), "Output address, e.g.: \"tcp://localhost:5555\"")
     ("data-out-rate-logging", bpo::value<int>()->default_value(1), "Log output rate on socket, 1/0")
+    ("data-out-transport", bpo::value<vector<string>>()->multitoken()->default_value(vector<string>(1, "zmq"), "zmq"), "Output transport: zmq/shm (descriptors of data in shared memory, for EPNs on the same host), one for all or one per output address")
+    ("data-out-codec", bpo::value<vector<string>>()->multitoken()->default_value(vector<string>(1, "none"), "none"), "Output codec: none/lz (fast)/shuffle-huffman (detector data), one for all or one per output address")
 
     ("hb-in-socket-type", bpo::value<string>()->default_value("sub"), "Heartbeat in socket type: sub/pull")
     ("hb-in-buff-size", bpo::value<int>()->default_value(100), "Heartbeat in buffer size in number of messages (ZeroMQ)/bytes(nanomsg)")
@@ -108,11 +153,31 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
   if (vm.count("flp-index"))             { _options->flpIndex             = vm["flp-index"].as<int>(); }
   if (vm.count("event-size"))            { _options->eventSize            = vm["event-size"].as<int>(); }
   if (vm.count("io-threads"))            { _options->ioThreads            = vm["io-threads"].as<int>(); }
+  if (vm.count("device-cpus"))           { _options->deviceCPUs           = vm["device-cpus"].as<string>(); }
+  if (vm.count("io-cpus"))               { _options->ioCPUs               = vm["io-cpus"].as<string>(); }
+  if (vm.count("numa-node"))             { _options->numaNode             = vm["numa-node"].as<int>(); }
+  if (vm.count("numa-nic"))              { _options->numaNIC              = vm["numa-nic"].as<string>(); }
   if (vm.count("num-epns"))              { _options->numEPNs              = vm["num-epns"].as<int>(); }
   if (vm.count("heartbeat-timeout"))     { _options->heartbeatTimeoutInMs = vm["heartbeat-timeout"].as<int>(); }
   if (vm.count("test-mode"))             { _options->testMode             = vm["test-mode"].as<int>(); }
   if (vm.count("send-offset"))           { _options->sendOffset           = vm["send-offset"].as<int>(); }
   if (vm.count("send-delay"))            { _options->sendDelay            = vm["send-delay"].as<int>(); }
+  if (vm.count("epn-selection"))         { _options->epnSelection         = vm["epn-selection"].as<string>(); }
+  if (vm.count("dead-epn-policy"))       { _options->deadEPNPolicy        = vm["dead-epn-policy"].as<string>(); }
+  if (vm.count("hold-limit"))            { _options->holdLimit            = vm["hold-limit"].as<int>(); }
+  if (vm.count("buffer-size"))           { _options->bufferSize           = vm["buffer-size"].as<int>(); }
+  if (vm.count("send-rate"))             { _options->sendRate             = vm["send-rate"].as<int>(); }
+  if (vm.count("send-burst"))            { _options->sendBurst            = vm["send-burst"].as<int>(); }
+  if (vm.count("output-queue-size"))     { _options->outputQueueSize      = vm["output-queue-size"].as<int>(); }
+  if (vm.count("overflow-policy"))       { _options->overflowPolicy       = vm["overflow-policy"].as<string>(); }
+  if (vm.count("metrics-file"))          { _options->metricsFile          = vm["metrics-file"].as<string>(); }
+  if (vm.count("metrics-interval"))      { _options->metricsIntervalInMs  = vm["metrics-interval"].as<int>(); }
+  if (vm.count("metrics-address"))       { _options->metricsAddress       = vm["metrics-address"].as<string>(); }
+  if (vm.count("membership-in-address")) { _options->membershipInAddress  = vm["membership-in-address"].as<string>(); }
+  if (vm.count("shm-segment-name"))      { _options->shmSegmentName       = vm["shm-segment-name"].as<string>(); }
+  if (vm.count("shm-segment-size"))      { _options->shmSegmentSize       = vm["shm-segment-size"].as<int>(); }
+  if (vm.count("codec-element-size"))    { _options->codecElementSize     = vm["codec-element-size"].as<int>(); }
+  if (vm.count("compression-threads"))   { _options->compressionThreads   = vm["compression-threads"].as<int>(); }
 
   if (vm.count("data-in-socket-type"))   { _options->dataInSocketType     = vm["data-in-socket-type"].as<string>(); }
   if (vm.count("data-in-buff-size"))     { _options->dataInBufSize        = vm["data-in-buff-size"].as<int>(); }
@@ -125,6 +190,8 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
   if (vm.count("data-out-method"))       { _options->dataOutMethod        = vm["data-out-method"].as<string>(); }
   // if (vm.count("data-out-address"))      { _options->dataOutAddress       = vm["data-out-address"].as<vector<string>>(); }
   if (vm.count("data-out-rate-logging")) { _options->dataOutRateLogging   = vm["data-out-rate-logging"].as<int>(); }
+  if (vm.count("data-out-transport"))    { _options->dataOutTransport     = vm["data-out-transport"].as<vector<string>>(); }
+  if (vm.count("data-out-codec"))        { _options->dataOutCodec         = vm["data-out-codec"].as<vector<string>>(); }
 
   if (vm.count("hb-in-socket-type"))     { _options->hbInSocketType       = vm["hb-in-socket-type"].as<string>(); }
   if (vm.count("hb-in-buff-size"))       { _options->hbInBufSize          = vm["hb-in-buff-size"].as<int>(); }
@@ -184,6 +251,15 @@ int main(int argc, char** argv)
   // store the IP addresses to be given to device for initialization
   string ownAddress  = ss.str();
 
+  // place the threads and the message buffers, before the device starts any of them
+  DevicePlacement placement;
+  if (!placement.Configure(options.deviceCPUs, options.ioCPUs, options.numaNode, options.numaNIC)) {
+    return 1;
+  }
+  placement.SetMemoryPolicy();
+  placement.PinIoThreads();
+  placement.Report();
+
   // configure the transport interface
   FairMQTransportFactory* transportFactory = new FairMQTransportFactoryZMQ();
   flp.SetTransport(transportFactory);
@@ -199,6 +275,32 @@ int main(int argc, char** argv)
   flp.SetProperty(FLPSender::HeartbeatTimeoutInMs, options.heartbeatTimeoutInMs);
   flp.SetProperty(FLPSender::TestMode, options.testMode);
   flp.SetProperty(FLPSender::SendOffset, options.sendOffset);
+  flp.SetProperty(FLPSender::EPNSelection, options.epnSelection);
+  flp.SetProperty(FLPSender::DeadEPNPolicy, options.deadEPNPolicy);
+  flp.SetProperty(FLPSender::HoldLimit, options.holdLimit);
+  flp.SetProperty(FLPSender::BufferSize, options.bufferSize);
+  flp.SetProperty(FLPSender::SendRate, options.sendRate);
+  flp.SetProperty(FLPSender::SendBurst, options.sendBurst);
+  flp.SetProperty(FLPSender::OutputQueueSize, options.outputQueueSize);
+  flp.SetProperty(FLPSender::OverflowPolicy, options.overflowPolicy);
+  flp.SetProperty(FLPSender::MetricsFile, options.metricsFile);
+  flp.SetProperty(FLPSender::MetricsIntervalInMs, options.metricsIntervalInMs);
+  // one transport for all data-out channels, or a comma-separated list with one per channel
+  string dataOutTransport;
+  for (size_t i = 0; i < options.dataOutTransport.size(); ++i) {
+    dataOutTransport += (i > 0 ? "," : "") + options.dataOutTransport.at(i);
+  }
+  flp.SetProperty(FLPSender::DataOutTransport, dataOutTransport);
+  flp.SetProperty(FLPSender::ShmSegmentName, options.shmSegmentName);
+  flp.SetProperty(FLPSender::ShmSegmentSize, options.shmSegmentSize);
+  // one codec for all data-out channels, or a comma-separated list with one per channel
+  string dataOutCodec;
+  for (size_t i = 0; i < options.dataOutCodec.size(); ++i) {
+    dataOutCodec += (i > 0 ? "," : "") + options.dataOutCodec.at(i);
+  }
+  flp.SetProperty(FLPSender::DataOutCodec, dataOutCodec);
+  flp.SetProperty(FLPSender::CodecElementSize, options.codecElementSize);
+  flp.SetProperty(FLPSender::CompressionThreads, options.compressionThreads);
 
   // configure data input channel (address is set later when received from DDS).
   FairMQChannel dataInChannel(options.dataInSocketType, options.dataInMethod, "");
@@ -223,6 +325,18 @@ int main(int argc, char** argv)
   hbInChannel.UpdateRateLogging(options.hbInRateLogging);
   flp.fChannels["heartbeat-in"].push_back(hbInChannel);
 
+  // configure the optional metrics output channel
+  if (!options.metricsAddress.empty()) {
+    FairMQChannel metricsOutChannel("pub", "bind", options.metricsAddress);
+    flp.fChannels["metrics-out"].push_back(metricsOutChannel);
+  }
+
+  // configure the optional membership input channel
+  if (!options.membershipInAddress.empty()) {
+    FairMQChannel membershipInChannel("sub", "connect", options.membershipInAddress);
+    flp.fChannels["membership-in"].push_back(membershipInChannel);
+  }
+
   if (options.testMode == 1) {
     // in test mode, retreive the output address of FLPSyncSampler to connect to and assign it to device
     dds::key_value::CKeyValue::valuesMap_t values;
@@ -286,6 +400,9 @@ int main(int argc, char** argv)
   flp.ChangeState("INIT_TASK");
   flp.WaitForEndOfState("INIT_TASK");
 
+  // the device thread is started with the affinity of this thread, the I/O threads keep theirs.
+  placement.PinDeviceThreads();
+
   flp.ChangeState("RUN");
   flp.WaitForEndOfState("RUN");
 
@@ -5,32 +5,268 @@
  * @author D. Klein, A. Rybalchenko, M.Al-Turany
  */
 
+#include <vector>
+#include <chrono>
+#include <cstdlib> // strtod
+
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
 #include "O2EPNex.h"
 #include "FairMQLogger.h"
 
-O2EPNex::O2EPNex()
+using namespace std;
+
+O2EPNex::O2EPNex() :
+  fProcessingModeName("none"),
+  fProcessingMode(ProcessNone),
+  fNsPerByteValue("1"),
+  fNsPerByte(1),
+  fReductionPasses(1),
+  fNumWorkers(0),
+  fWorkQueueSize(100),
+  fWorkQueue(),
+  fWorkMutex(),
+  fWorkAvailable(),
+  fSpaceAvailable(),
+  fStopWorkers(false),
+  fNumProcessed(0),
+  fBytesProcessed(0)
 {
 }
 
+void O2EPNex::InitTask()
+{
+  if (fProcessingModeName == "none") {
+    fProcessingMode = ProcessNone;
+  } else if (fProcessingModeName == "reduce") {
+    fProcessingMode = ProcessReduce;
+  } else if (fProcessingModeName == "busy") {
+    fProcessingMode = ProcessBusy;
+  } else {
+    LOG(ERROR) << "Unknown processing mode: " << fProcessingModeName << ", using 'none'.";
+    fProcessingModeName = "none";
+    fProcessingMode = ProcessNone;
+  }
+
+  char* end = nullptr;
+  fNsPerByte = strtod(fNsPerByteValue.c_str(), &end);
+  if (end == fNsPerByteValue.c_str() || *end != '\0' || fNsPerByte < 0) {
+    LOG(ERROR) << "Invalid busy time per byte: " << fNsPerByteValue << ", using 1 ns.";
+    fNsPerByteValue = "1";
+    fNsPerByte = 1;
+  }
+
+  if (fWorkQueueSize < 1) {
+    fWorkQueueSize = 1;
+  }
+
+  LOG(INFO) << "Processing mode: " << fProcessingModeName << ", workers: " << fNumWorkers;
+}
+
 void O2EPNex::Run()
 {
+  fNumProcessed = 0;
+  fBytesProcessed = 0;
+  fStopWorkers = false;
+
+  boost::thread_group workers;
+  for (int i = 0; i < fNumWorkers; ++i) {
+    workers.create_thread(boost::bind(&O2EPNex::Work, this));
+  }
+
+  double result = 0;
+  auto start = chrono::steady_clock::now();
+
   while (CheckCurrentState(RUNNING)) {
     FairMQMessage* msg = fTransportFactory->CreateMessage();
 
-    fChannels["data-in"].at(0).Receive(msg);
+    if (fChannels["data-in"].at(0).Receive(msg) <= 0) {
+      delete msg;
+      continue;
+    }
 
-    int inputSize = msg->GetSize();
-    int numInput = inputSize / sizeof(Content);
-    Content* input = reinterpret_cast<Content*>(msg->GetData());
+    if (fNumWorkers > 0) {
+      // does not return while the workers are busy, the messages pile up in the input socket and upstream.
+      if (!Enqueue(msg)) {
+        delete msg;
+      }
+    } else {
+      result += Process(msg);
+      delete msg;
+    }
+  }
 
-    // for (int i = 0; i < numInput; ++i) {
-    //     LOG(INFO) << (&input[i])->x << " " << (&input[i])->y << " " << (&input[i])->z << " " << (&input[i])->a << " " << (&input[i])->b;
-    // }
+  {
+    boost::lock_guard<boost::mutex> lock(fWorkMutex);
+    fStopWorkers = true;
+  }
+  fWorkAvailable.notify_all();
+  workers.join_all();
+
+  // messages still queued when the device stopped are not processed.
+  for (auto it = fWorkQueue.begin(); it != fWorkQueue.end(); ++it) {
+    delete *it;
+  }
+  fWorkQueue.clear();
+
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  LOG(INFO) << "Processed " << fNumProcessed << " messages (" << fBytesProcessed / 1048576. << " MB) in "
+            << seconds << " s, " << (seconds > 0 ? fBytesProcessed / 1048576. / seconds : 0) << " MB/s";
+  LOG(DEBUG) << "Result: " << result;
+}
+
+bool O2EPNex::Enqueue(FairMQMessage* msg)
+{
+  boost::unique_lock<boost::mutex> lock(fWorkMutex);
+
+  while (fWorkQueue.size() >= static_cast<size_t>(fWorkQueueSize)) {
+    // wake up periodically to notice when the device is stopped.
+    fSpaceAvailable.wait_for(lock, boost::chrono::milliseconds(100));
+    if (!CheckCurrentState(RUNNING)) {
+      return false;
+    }
+  }
 
+  fWorkQueue.push_back(msg);
+  lock.unlock();
+  fWorkAvailable.notify_one();
+
+  return true;
+}
+
+void O2EPNex::Work()
+{
+  double result = 0;
+
+  while (true) {
+    FairMQMessage* msg = nullptr;
+
+    {
+      boost::unique_lock<boost::mutex> lock(fWorkMutex);
+      while (fWorkQueue.empty() && !fStopWorkers) {
+        fWorkAvailable.wait(lock);
+      }
+      if (fStopWorkers) {
+        break;
+      }
+      msg = fWorkQueue.front();
+      fWorkQueue.pop_front();
+    }
+    fSpaceAvailable.notify_one();
+
+    result += Process(msg);
     delete msg;
   }
+
+  LOG(DEBUG) << "Worker result: " << result;
+}
+
+double O2EPNex::Process(FairMQMessage* msg)
+{
+  size_t inputSize = msg->GetSize();
+  double result = 0;
+
+  switch (fProcessingMode) {
+  case ProcessReduce: {
+    int numInput = inputSize / sizeof(Content);
+    const Content* input = reinterpret_cast<const Content*>(msg->GetData());
+    for (int i = 0; i < fReductionPasses; ++i) {
+      result += Reduce(input, numInput);
+    }
+    break;
+  }
+  case ProcessBusy: {
+    auto end = chrono::steady_clock::now() + chrono::nanoseconds(static_cast<int64_t>(inputSize * fNsPerByte));
+    // spin instead of sleeping, the core stays occupied as with real processing.
+    while (chrono::steady_clock::now() < end) {
+    }
+    break;
+  }
+  default:
+    break;
+  }
+
+  ++fNumProcessed;
+  fBytesProcessed += inputSize;
+
+  return result;
+}
+
+double O2EPNex::Reduce(const Content* input, int numInput) const
+{
+  // independent accumulators, no dependency of one iteration on the previous one.
+  double sum[4] = { 0, 0, 0, 0 };
+
+  int i = 0;
+  for (; i + 4 <= numInput; i += 4) {
+    for (int j = 0; j < 4; ++j) {
+      sum[j] += input[i + j].a * input[i + j].b + (input[i + j].x + input[i + j].y + input[i + j].z);
+    }
+  }
+  for (; i < numInput; ++i) {
+    sum[0] += input[i].a * input[i].b + (input[i].x + input[i].y + input[i].z);
+  }
+
+  return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+void O2EPNex::SetProperty(const int key, const string& value)
+{
+  switch (key) {
+  case ProcessingMode:
+    fProcessingModeName = value;
+    break;
+  case NsPerByte:
+    fNsPerByteValue = value;
+    break;
+  default:
+    FairMQDevice::SetProperty(key, value);
+    break;
+  }
+}
+
+string O2EPNex::GetProperty(const int key, const string& default_/*= ""*/)
+{
+  switch (key) {
+  case ProcessingMode:
+    return fProcessingModeName;
+  case NsPerByte:
+    return fNsPerByteValue;
+  default:
+    return FairMQDevice::GetProperty(key, default_);
+  }
+}
+
+void O2EPNex::SetProperty(const int key, const int value)
+{
+  switch (key) {
+  case ReductionPasses:
+    fReductionPasses = value;
+    break;
+  case NumWorkers:
+    fNumWorkers = value;
+    break;
+  case WorkQueueSize:
+    fWorkQueueSize = value;
+    break;
+  default:
+    FairMQDevice::SetProperty(key, value);
+    break;
+  }
+}
+
+int O2EPNex::GetProperty(const int key, const int default_/*= 0*/)
+{
+  switch (key) {
+  case ReductionPasses:
+    return fReductionPasses;
+  case NumWorkers:
+    return fNumWorkers;
+  case WorkQueueSize:
+    return fWorkQueueSize;
+  default:
+    return FairMQDevice::GetProperty(key, default_);
+  }
 }
 
 O2EPNex::~O2EPNex()
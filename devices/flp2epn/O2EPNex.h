@@ -8,6 +8,12 @@
 #ifndef O2EPNEX_H_
 #define O2EPNEX_H_
 
+#include <string>
+#include <deque>
+#include <atomic>
+
+#include <boost/thread.hpp>
+
 #include "FairMQDevice.h"
 
 struct Content {
@@ -18,13 +24,71 @@ struct Content {
   int z;
 };
 
+/// Receives messages and emulates their processing
+///
+/// Processing modes: "none" (discard), "reduce" (reduction over the Content records, ReductionPasses times)
+/// and "busy" (busy loop of NsPerByte nanoseconds per byte, without sleeping).
+/// With NumWorkers > 0 the messages are processed by a pool of worker threads, fed through a queue of
+/// WorkQueueSize messages. When the queue is full the device stops receiving, so the backpressure
+/// propagates upstream as it would with a busy EPN.
+
 class O2EPNex : public FairMQDevice
 {
   public:
+    enum {
+      ProcessingMode = FairMQDevice::Last,
+      NsPerByte,
+      ReductionPasses,
+      NumWorkers,
+      WorkQueueSize,
+      Last
+    };
+
     O2EPNex();
     virtual ~O2EPNex();
+
+    virtual void SetProperty(const int key, const std::string& value);
+    virtual std::string GetProperty(const int key, const std::string& default_ = "");
+    virtual void SetProperty(const int key, const int value);
+    virtual int GetProperty(const int key, const int default_ = 0);
+
   protected:
+    enum ProcessingModes {
+      ProcessNone,
+      ProcessReduce,
+      ProcessBusy
+    };
+
+    std::string fProcessingModeName; ///< "none", "reduce" or "busy"
+    int fProcessingMode; ///< see ProcessingModes
+    std::string fNsPerByteValue; ///< Busy time per byte in nanoseconds as set, may be fractional, e.g. "0.25"
+    double fNsPerByte; ///< Busy time per byte in nanoseconds (busy mode)
+    int fReductionPasses; ///< Passes over the records (reduce mode)
+    int fNumWorkers; ///< Number of worker threads (0 - process in the receiving thread)
+    int fWorkQueueSize; ///< Maximum number of messages waiting for the workers
+
+    std::deque<FairMQMessage*> fWorkQueue; ///< Messages waiting for the workers
+    boost::mutex fWorkMutex; ///< Protects fWorkQueue and fStopWorkers
+    boost::condition_variable fWorkAvailable; ///< Signalled when a message is queued
+    boost::condition_variable fSpaceAvailable; ///< Signalled when a message is taken from the queue
+    bool fStopWorkers; ///< Set when the workers should finish
+
+    std::atomic<unsigned long> fNumProcessed; ///< Number of processed messages
+    std::atomic<unsigned long> fBytesProcessed; ///< Number of processed bytes
+
+    virtual void InitTask();
     virtual void Run();
+
+    /// Processing of one message according to the processing mode
+    /// @return Result of the reduction (0 in the other modes), to keep the computation from being optimized out
+    double Process(FairMQMessage* msg);
+    /// Reduction over the records, with independent accumulators so that the loop can be vectorized
+    double Reduce(const Content* input, int numInput) const;
+    /// Worker thread, processes messages from the queue
+    void Work();
+    /// Queues a message for the workers, waits while the queue is full
+    /// @return false if the device stopped running before there was space in the queue
+    bool Enqueue(FairMQMessage* msg);
 };
 
 #endif
@@ -9,44 +9,24 @@
 #include <boost/bind.hpp>
 
 #include "O2EpnMerger.h"
+#include "O2MergerEngine.h"
 #include "FairMQLogger.h"
 
-O2EpnMerger::O2EpnMerger()
+using namespace std;
+
+O2EpnMerger::O2EpnMerger() :
+  fMergeWindowInMs(0)
 {
 }
 
 void O2EpnMerger::Run()
 {
-  FairMQPoller* poller = fTransportFactory->CreatePoller(fChannels["data-in"]);
-
-  bool received = false;
-  int NoOfMsgParts = fChannels["data-in"].size() - 1;
+  O2MergerEngine merger(fTransportFactory, fChannels["data-in"], fChannels["data-out"].at(0), fMergeWindowInMs);
 
   while (CheckCurrentState(RUNNING)) {
-    FairMQMessage* msg = fTransportFactory->CreateMessage();
-
-    poller->Poll(100);
-
-    for (int i = 0; i < fChannels["data-in"].size(); i++) {
-      if (poller->CheckInput(i)) {
-        if (fChannels["data-in"].at(i).Receive(msg)) {
-          // LOG(INFO) << "------ recieve Msg from " << i ;
-          if (i < NoOfMsgParts) {
-            fChannels["data-out"].at(0).Send(msg, "snd-more");
-            //    LOG(INFO) << "------ Send  Msg Part " << i ;
-          } else {
-            fChannels["data-out"].at(0).Send(msg);
-            //    LOG(INFO) << "------ Send  last Msg Part " << i ;
-          }
-        }
-      }
-    }
-
-    delete msg;
+    merger.Step(100);
   }
 
-  delete poller;
-
 //--------------------
 
   // while (CheckCurrentState(RUNNING)) {
@@ -66,6 +46,45 @@ void O2EpnMerger::Run()
   // }
 }
 
+void O2EpnMerger::SetProperty(const int key, const string& value)
+{
+  switch (key) {
+  default:
+    FairMQDevice::SetProperty(key, value);
+    break;
+  }
+}
+
+string O2EpnMerger::GetProperty(const int key, const string& default_/*= ""*/)
+{
+  switch (key) {
+  default:
+    return FairMQDevice::GetProperty(key, default_);
+  }
+}
+
+void O2EpnMerger::SetProperty(const int key, const int value)
+{
+  switch (key) {
+  case MergeWindowInMs:
+    fMergeWindowInMs = value;
+    break;
+  default:
+    FairMQDevice::SetProperty(key, value);
+    break;
+  }
+}
+
+int O2EpnMerger::GetProperty(const int key, const int default_/*= 0*/)
+{
+  switch (key) {
+  case MergeWindowInMs:
+    return fMergeWindowInMs;
+  default:
+    return FairMQDevice::GetProperty(key, default_);
+  }
+}
+
 O2EpnMerger::~O2EpnMerger()
 {
 }
@@ -8,6 +8,8 @@
 #ifndef O2EpnMerger_H_
 #define O2EpnMerger_H_
 
+#include <string>
+
 #include "FairMQDevice.h"
 
 struct Content {
@@ -21,9 +23,22 @@ struct Content {
 class O2EpnMerger: public FairMQDevice
 {
   public:
+    enum {
+      MergeWindowInMs = FairMQDevice::Last,
+      Last
+    };
+
     O2EpnMerger();
     virtual ~O2EpnMerger();
+
+    virtual void SetProperty(const int key, const std::string& value);
+    virtual std::string GetProperty(const int key, const std::string& default_ = "");
+    virtual void SetProperty(const int key, const int value);
+    virtual int GetProperty(const int key, const int default_ = 0);
+
   protected:
+    int fMergeWindowInMs; ///< Time to wait for the remaining inputs of a batch (0 - wait for all), see O2MergerEngine
+
     virtual void Run();
 };
 
@@ -6,8 +6,7 @@
  */
 
 #include <vector>
-#include <stdlib.h>     /* srand, rand */
-#include <time.h>       /* time */
+#include <algorithm> // min
 
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
@@ -17,8 +16,47 @@
 
 using namespace std;
 
+namespace
+{
+/// SplitMix64 finalizer: a pseudo-random value as a function of a counter alone
+inline uint64_t Mix(uint64_t z)
+{
+  z += 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+/// Maps 16 random bits to [1, 100] without a division
+inline int Scale(uint64_t bits)
+{
+  return static_cast<int>(((bits & 0xFFFF) * 100) >> 16) + 1;
+}
+
+/// Reciprocals of the values returned by Scale(), to replace the divisions by multiplications
+struct Reciprocals
+{
+  double values[101];
+
+  Reciprocals()
+  {
+    values[0] = 0;
+    for (int i = 1; i <= 100; ++i) {
+      values[i] = 1. / i;
+    }
+  }
+};
+
+const Reciprocals reciprocals;
+}
+
 O2FLPex::O2FLPex() :
-  fEventSize(10000)
+  fEventSize(10000),
+  fSizeDistribution("fixed"),
+  fPayloadPoolSize(0),
+  fPayloadPool(),
+  fSizeGenerator(random_device()()),
+  fCounter(0)
 {
 }
 
@@ -29,32 +67,76 @@ O2FLPex::~O2FLPex()
 void O2FLPex::Init()
 {
   FairMQDevice::Init();
+
+  if (fSizeDistribution != "fixed" && fSizeDistribution != "uniform" && fSizeDistribution != "exponential") {
+    LOG(ERROR) << "Unknown size distribution: " << fSizeDistribution << ", using 'fixed'.";
+    fSizeDistribution = "fixed";
+  }
+
+  fCounter = fSizeGenerator();
+
+  fPayloadPool.clear();
+  for (int i = 0; i < fPayloadPoolSize; ++i) {
+    fPayloadPool.push_back(vector<Content>(NextEventSize()));
+    Generate(fPayloadPool.back().data(), fPayloadPool.back().size());
+  }
+}
+
+int O2FLPex::NextEventSize()
+{
+  if (fSizeDistribution == "uniform") {
+    return uniform_int_distribution<int>(1, max(1, 2 * fEventSize - 1))(fSizeGenerator);
+  } else if (fSizeDistribution == "exponential") {
+    int size = static_cast<int>(exponential_distribution<double>(1. / fEventSize)(fSizeGenerator));
+    return min(max(size, 1), 8 * fEventSize);
+  }
+  return fEventSize;
+}
+
+void O2FLPex::Generate(Content* payload, int numRecords)
+{
+  uint64_t counter = fCounter;
+
+  // every record depends only on its counter value, the iterations are independent.
+  for (int i = 0; i < numRecords; ++i) {
+    uint64_t r1 = Mix(counter + 2 * i);
+    uint64_t r2 = Mix(counter + 2 * i + 1);
+    payload[i].id = static_cast<int>(counter / 2 + i);
+    payload[i].x = Scale(r1);
+    payload[i].y = Scale(r1 >> 16);
+    payload[i].z = Scale(r1 >> 32);
+    payload[i].a = Scale(r2) * reciprocals.values[Scale(r2 >> 16)];
+    payload[i].b = Scale(r2 >> 32) * reciprocals.values[Scale(r2 >> 48)];
+  }
+
+  fCounter = counter + 2 * static_cast<uint64_t>(numRecords);
 }
 
 void O2FLPex::Run()
 {
-  srand(time(NULL));
+  if (fPayloadPoolSize > 0) {
+    LOG(DEBUG) << "Sending " << fPayloadPool.size() << " pre-generated payloads round-robin.";
+  } else {
+    LOG(DEBUG) << "Message size: " << fEventSize * sizeof(Content) << " bytes (" << fSizeDistribution << ").";
+  }
 
-  LOG(DEBUG) << "Message size: " << fEventSize * sizeof(Content) << " bytes.";
+  size_t poolIndex = 0;
 
   while (CheckCurrentState(RUNNING)) {
-    Content* payload = new Content[fEventSize];
-
-    for (int i = 0; i < fEventSize; ++i) {
-      (&payload[i])->x = rand() % 100 + 1;
-      (&payload[i])->y = rand() % 100 + 1;
-      (&payload[i])->z = rand() % 100 + 1;
-      (&payload[i])->a = (rand() % 100 + 1) / (rand() % 100 + 1);
-      (&payload[i])->b = (rand() % 100 + 1) / (rand() % 100 + 1);
-      // LOG(INFO) << (&payload[i])->x << " " << (&payload[i])->y << " " << (&payload[i])->z << " " << (&payload[i])->a << " " << (&payload[i])->b;
+    FairMQMessage* msg;
+
+    if (!fPayloadPool.empty()) {
+      vector<Content>& payload = fPayloadPool[poolIndex];
+      poolIndex = (poolIndex + 1) % fPayloadPool.size();
+      msg = fTransportFactory->CreateMessage(payload.data(), payload.size() * sizeof(Content), &O2FLPex::NoCleanup);
+    } else {
+      int numRecords = NextEventSize();
+      msg = fTransportFactory->CreateMessage(numRecords * sizeof(Content));
+      Generate(static_cast<Content*>(msg->GetData()), numRecords);
     }
 
-    FairMQMessage* msg = fTransportFactory->CreateMessage(fEventSize * sizeof(Content));
-    memcpy(msg->GetData(), payload, fEventSize * sizeof(Content));
-
     fChannels["data-out"].at(0).Send(msg);
 
-    delete[] payload;
     delete msg;
   }
 }
@@ -62,6 +144,9 @@ void O2FLPex::Run()
 void O2FLPex::SetProperty(const int key, const string& value)
 {
   switch (key) {
+  case SizeDistribution:
+    fSizeDistribution = value;
+    break;
   default:
     FairMQDevice::SetProperty(key, value);
     break;
@@ -71,6 +156,8 @@ void O2FLPex::SetProperty(const int key, const string& value)
 string O2FLPex::GetProperty(const int key, const string& default_/*= ""*/)
 {
   switch (key) {
+  case SizeDistribution:
+    return fSizeDistribution;
   default:
     return FairMQDevice::GetProperty(key, default_);
   }
@@ -82,6 +169,9 @@ void O2FLPex::SetProperty(const int key, const int value)
   case EventSize:
     fEventSize = value;
     break;
+  case PayloadPoolSize:
+    fPayloadPoolSize = value;
+    break;
   default:
     FairMQDevice::SetProperty(key, value);
     break;
@@ -93,6 +183,8 @@ int O2FLPex::GetProperty(const int key, const int default_/*= 0*/)
   switch (key) {
   case EventSize:
     return fEventSize;
+  case PayloadPoolSize:
+    return fPayloadPoolSize;
   default:
     return FairMQDevice::GetProperty(key, default_);
   }
@@ -9,6 +9,9 @@
 #define O2FLPEX_H_
 
 #include <string>
+#include <vector>
+#include <random>
+#include <cstdint>
 
 #include "FairMQDevice.h"
 
@@ -21,12 +24,22 @@ struct Content {
   int z;
 };
 
+/// Sends messages of random Content records
+///
+/// The records are generated directly into the message buffer by a counter-based generator, without
+/// dependencies between records, so the iterations of the fill loop overlap in the pipeline. With PayloadPoolSize > 0
+/// the payloads are generated once and sent round-robin without copying. The number of records per message
+/// is EventSize ("fixed"), uniform in [1, 2 * EventSize - 1] ("uniform") or exponential with mean EventSize,
+/// limited to 8 * EventSize ("exponential").
+
 class O2FLPex : public FairMQDevice
 {
   public:
     enum {
       InputFile = FairMQDevice::Last,
       EventSize,
+      SizeDistribution,
+      PayloadPoolSize,
       Last
     };
     O2FLPex();
@@ -40,9 +53,22 @@ class O2FLPex : public FairMQDevice
 
   protected:
     int fEventSize;
+    std::string fSizeDistribution; ///< "fixed", "uniform" or "exponential"
+    int fPayloadPoolSize; ///< Number of pre-generated payloads (0 - generate every message)
+
+    std::vector<std::vector<Content>> fPayloadPool; ///< Pre-generated payloads, sent round-robin
+    std::mt19937_64 fSizeGenerator; ///< Generator for the message sizes
+    uint64_t fCounter; ///< Index of the next record to generate
 
     virtual void Init();
     virtual void Run();
+
+    /// Number of records of the next message, according to the size distribution
+    int NextEventSize();
+    /// Fills records with pseudo-random values, advancing the counter
+    void Generate(Content* payload, int numRecords);
+    /// Free function of the messages referencing the payload pool (the pool outlives the sockets)
+    static void NoCleanup(void* /*data*/, void* /*hint*/) {}
 };
 
 #endif
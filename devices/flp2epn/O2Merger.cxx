@@ -10,8 +10,12 @@
 
 #include "FairMQLogger.h"
 #include "O2Merger.h"
-#include "FairMQPoller.h"
-O2Merger::O2Merger()
+#include "O2MergerEngine.h"
+
+using namespace std;
+
+O2Merger::O2Merger() :
+  fMergeWindowInMs(0)
 {
 }
 
@@ -21,33 +25,49 @@ O2Merger::~O2Merger()
 
 void O2Merger::Run()
 {
-  FairMQPoller* poller = fTransportFactory->CreatePoller(fChannels["data-in"]);
-
-  int NoOfMsgParts = fChannels["data-in"].size() - 1;
+  O2MergerEngine merger(fTransportFactory, fChannels["data-in"], fChannels["data-out"].at(0), fMergeWindowInMs);
 
   while (CheckCurrentState(RUNNING)) {
-    FairMQMessage* msg = fTransportFactory->CreateMessage();
-
-    poller->Poll(100);
-
-    for (int i = 0; i < fChannels["data-in"].size(); i++) {
-      if (poller->CheckInput(i)) {
-        if (fChannels["data-in"].at(i).Receive(msg)) {
-          // LOG(INFO) << "------ recieve Msg from " << i ;
-          if (i < NoOfMsgParts) {
-            fChannels["data-out"].at(0).Send(msg, "snd-more");
-            //    LOG(INFO) << "------ Send  Msg Part " << i ;
-          } else {
-            fChannels["data-out"].at(0).Send(msg);
-            //    LOG(INFO) << "------ Send  last Msg Part " << i ;
-          }
-        }
-      }
-    }
-
-    delete msg;
+    merger.Step(100);
+  }
+}
+
+void O2Merger::SetProperty(const int key, const string& value)
+{
+  switch (key) {
+  default:
+    FairMQDevice::SetProperty(key, value);
+    break;
+  }
+}
+
+string O2Merger::GetProperty(const int key, const string& default_/*= ""*/)
+{
+  switch (key) {
+  default:
+    return FairMQDevice::GetProperty(key, default_);
   }
+}
 
-  delete poller;
+void O2Merger::SetProperty(const int key, const int value)
+{
+  switch (key) {
+  case MergeWindowInMs:
+    fMergeWindowInMs = value;
+    break;
+  default:
+    FairMQDevice::SetProperty(key, value);
+    break;
+  }
+}
+
+int O2Merger::GetProperty(const int key, const int default_/*= 0*/)
+{
+  switch (key) {
+  case MergeWindowInMs:
+    return fMergeWindowInMs;
+  default:
+    return FairMQDevice::GetProperty(key, default_);
+  }
 }
 
@@ -8,15 +8,30 @@
 #ifndef O2Merger_H_
 #define O2Merger_H_
 
+#include <string>
+
 #include "FairMQDevice.h"
 
 
 class O2Merger: public FairMQDevice
 {
   public:
+    enum {
+      MergeWindowInMs = FairMQDevice::Last,
+      Last
+    };
+
     O2Merger();
     virtual ~O2Merger();
+
+    virtual void SetProperty(const int key, const std::string& value);
+    virtual std::string GetProperty(const int key, const std::string& default_ = "");
+    virtual void SetProperty(const int key, const int value);
+    virtual int GetProperty(const int key, const int default_ = 0);
+
   protected:
+    int fMergeWindowInMs; ///< Time to wait for the remaining inputs of a batch (0 - wait for all), see O2MergerEngine
+
     virtual void Run();
 };
 
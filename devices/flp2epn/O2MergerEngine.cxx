@@ -0,0 +1,160 @@
+/**
+ * O2MergerEngine.cxx
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#include <algorithm> // max, min
+
+#include "FairMQLogger.h"
+#include "O2MergerEngine.h"
+
+using namespace std;
+
+O2MergerEngine::O2MergerEngine(FairMQTransportFactory* factory, vector<FairMQChannel>& inputs, FairMQChannel& output, int windowInMs)
+  : fTransportFactory(factory)
+  , fInputs(inputs)
+  , fOutput(output)
+  , fWindowInMs(windowInMs)
+  , fPoller(factory->CreatePoller(inputs))
+  , fInputPollers()
+  , fPool(inputs.size())
+  , fNumParts(inputs.size(), 0)
+  , fNumReady(0)
+  , fNextInput(0)
+  , fBatchStart()
+{
+  for (size_t i = 0; i < fPool.size(); ++i) {
+    fPool.at(i).push_back(fTransportFactory->CreateMessage());
+    fInputPollers.push_back(unique_ptr<FairMQPoller>(fTransportFactory->CreatePoller(vector<FairMQChannel>(1, fInputs.at(i)))));
+  }
+}
+
+O2MergerEngine::~O2MergerEngine()
+{
+  for (size_t i = 0; i < fPool.size(); ++i) {
+    for (size_t j = 0; j < fPool[i].size(); ++j) {
+      delete fPool[i][j];
+    }
+  }
+}
+
+void O2MergerEngine::Step(int timeoutInMs)
+{
+  int numInputs = fInputs.size();
+
+  if (fNumReady > 0 && fWindowInMs > 0) {
+    int elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - fBatchStart).count();
+    timeoutInMs = max(0, min(timeoutInMs, fWindowInMs - elapsed));
+  }
+
+  fPoller->Poll(timeoutInMs);
+
+  bool received = false;
+  bool contributedReady = false;
+
+  for (int k = 0; k < numInputs; ++k) {
+    int i = (fNextInput + k) % numInputs;
+
+    if (!fPoller->CheckInput(i)) {
+      continue;
+    }
+    // one message per input and batch, further ones stay in the socket.
+    if (fNumParts[i] > 0) {
+      contributedReady = true;
+      continue;
+    }
+    if (Receive(i)) {
+      received = true;
+    }
+  }
+
+  if (!received && contributedReady) {
+    // the poll returned at once for inputs that stay readable, polling all of them again would spin.
+    WaitForMissing(timeoutInMs);
+  }
+
+  fNextInput = (fNextInput + 1) % numInputs;
+
+  if (fNumReady == numInputs) {
+    Forward();
+  } else if (fNumReady > 0 && fWindowInMs > 0
+             && chrono::steady_clock::now() - fBatchStart >= chrono::milliseconds(fWindowInMs)) {
+    Forward();
+  }
+}
+
+bool O2MergerEngine::Receive(int input)
+{
+  vector<FairMQMessage*>& pool = fPool[input];
+  int numParts = 0;
+  do {
+    if (pool.size() == static_cast<size_t>(numParts)) {
+      pool.push_back(fTransportFactory->CreateMessage());
+    }
+    if (fInputs.at(input).Receive(pool[numParts]) >= 0) {
+      ++numParts;
+    }
+  } while (fInputs.at(input).ExpectsAnotherPart());
+
+  if (numParts == 0) {
+    return false;
+  }
+
+  if (fNumReady == 0) {
+    fBatchStart = chrono::steady_clock::now();
+  }
+  fNumParts[input] = numParts;
+  ++fNumReady;
+
+  return true;
+}
+
+void O2MergerEngine::WaitForMissing(int timeoutInMs)
+{
+  int numInputs = fInputs.size();
+  int input = fNextInput;
+  while (fNumParts[input] > 0) {
+    input = (input + 1) % numInputs;
+  }
+
+  // with several missing inputs the others are checked again after a short wait, the next step waits on another one.
+  if (numInputs - fNumReady > 1) {
+    timeoutInMs = min(timeoutInMs, 1);
+  }
+
+  FairMQPoller* poller = fInputPollers[input].get();
+  poller->Poll(timeoutInMs);
+  if (poller->CheckInput(0)) {
+    Receive(input);
+  }
+}
+
+void O2MergerEngine::Forward()
+{
+  int numInputs = fInputs.size();
+
+  for (int i = 0; i < numInputs; ++i) {
+    if (fNumParts[i] == 0) {
+      // empty placeholder for the missing input.
+      fPool[i][0]->Rebuild();
+      if (i == numInputs - 1) {
+        fOutput.Send(fPool[i][0]);
+      } else {
+        fOutput.Send(fPool[i][0], "snd-more");
+      }
+      continue;
+    }
+    for (int j = 0; j < fNumParts[i]; ++j) {
+      if (i == numInputs - 1 && j == fNumParts[i] - 1) {
+        fOutput.Send(fPool[i][j]);
+      } else {
+        fOutput.Send(fPool[i][j], "snd-more");
+      }
+    }
+    fNumParts[i] = 0;
+  }
+
+  fNumReady = 0;
+}
@@ -0,0 +1,69 @@
+/**
+ * O2MergerEngine.h
+ *
+ * @since 2026-10-17
+ * @author agent
+ */
+
+#ifndef O2MergerEngine_H_
+#define O2MergerEngine_H_
+
+#include <vector>
+#include <memory>
+#include <chrono>
+
+#include "FairMQChannel.h"
+#include "FairMQPoller.h"
+#include "FairMQTransportFactory.h"
+
+/// Merges the messages of N input channels into multipart messages on one output channel
+///
+/// A batch collects one (possibly multipart) message per input. It is forwarded as one multipart message,
+/// with the parts in input order, when all inputs contributed or, with a window > 0, when the window has passed
+/// since the first message of the batch. An input missing at that point is represented by one empty part,
+/// so the parts can still be assigned to the inputs. An input that already contributed is not read again until
+/// the batch is forwarded, so a hot input cannot starve the others: its messages wait in its socket (backpressure).
+/// If the poll returns only for such inputs, the step waits on the poller of one missing input instead,
+/// so waiting for a slow input does not spin. All pollers are created once. The inputs are read in round-robin
+/// order. Message objects are kept per input and reused for every batch.
+
+class O2MergerEngine
+{
+  public:
+    /// Constructor
+    /// @param factory      Transport factory
+    /// @param inputs       Input channels
+    /// @param output       Output channel
+    /// @param windowInMs   Time to wait for the remaining inputs after the first message of a batch (0 - wait for all)
+    O2MergerEngine(FairMQTransportFactory* factory, std::vector<FairMQChannel>& inputs, FairMQChannel& output, int windowInMs);
+    ~O2MergerEngine();
+
+    /// Polls the inputs once, receives from the ready ones and forwards the batch if it is complete
+    /// @param timeoutInMs  Maximum poll time
+    void Step(int timeoutInMs);
+
+  private:
+    /// Sends the collected messages as one multipart message
+    void Forward();
+    /// Receives a (possibly multipart) message from an input into its part of the batch
+    /// @return true if a message was received
+    bool Receive(int input);
+    /// Waits on the poller of the next missing input and receives from it if it becomes ready
+    /// @param timeoutInMs  Maximum poll time (shortened to 1 ms if more than one input is missing)
+    void WaitForMissing(int timeoutInMs);
+
+    FairMQTransportFactory* fTransportFactory;
+    std::vector<FairMQChannel>& fInputs;
+    FairMQChannel& fOutput;
+    int fWindowInMs;
+    std::unique_ptr<FairMQPoller> fPoller; ///< Poller over all inputs
+    std::vector<std::unique_ptr<FairMQPoller>> fInputPollers; ///< Poller over each single input, for waiting on a missing one
+
+    std::vector<std::vector<FairMQMessage*>> fPool; ///< Message objects per input, reused for every batch
+    std::vector<int> fNumParts; ///< Parts received per input in the current batch (0 - none yet)
+    int fNumReady; ///< Number of inputs that contributed to the current batch
+    int fNextInput; ///< Input read first in the next step
+    std::chrono::steady_clock::time_point fBatchStart; ///< Arrival of the first message of the current batch
+};
+
+#endif /* O2MergerEngine_H_ */
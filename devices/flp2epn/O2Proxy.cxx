@@ -5,43 +5,149 @@
  * @author A. Rybalchenko, M.Al-Turany
  */
 
+#include <memory>
+#include <chrono>
+
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
 
 #include "FairMQLogger.h"
+#include "FairMQPoller.h"
 #include "O2Proxy.h"
 
+using namespace std;
 
-
-O2Proxy::O2Proxy()
+O2Proxy::O2Proxy() :
+  fAggregateMessages(1),
+  fAggregationLatencyInMs(1),
+  fParts(),
+  fMessageEnds()
 {
 }
 
 O2Proxy::~O2Proxy()
 {
+  for (auto it = fParts.begin(); it != fParts.end(); ++it) {
+    delete *it;
+  }
+}
+
+void O2Proxy::ReceiveMessage(size_t& numParts)
+{
+  FairMQChannel& input = fChannels["data-in"].at(0);
+
+  do {
+    if (numParts == fParts.size()) {
+      fParts.push_back(fTransportFactory->CreateMessage());
+    }
+    if (input.Receive(fParts[numParts]) >= 0) {
+      ++numParts;
+    }
+  } while (input.ExpectsAnotherPart());
+
+  if (numParts > 0 && (fMessageEnds.empty() || fMessageEnds.back() < numParts)) {
+    fMessageEnds.push_back(numParts);
+  }
+}
+
+void O2Proxy::Forward()
+{
+  FairMQChannel& output = fChannels["data-out"].at(0);
+
+  size_t begin = 0;
+  for (size_t end : fMessageEnds) {
+    for (size_t i = begin; i + 1 < end; ++i) {
+      output.Send(fParts[i], "snd-more");
+    }
+    output.Send(fParts[end - 1]);
+    begin = end;
+  }
+
+  fMessageEnds.clear();
 }
 
 void O2Proxy::Run()
 {
+  if (fAggregateMessages <= 1) {
+    while (CheckCurrentState(RUNNING)) {
+      size_t numParts = 0;
+      ReceiveMessage(numParts);
+      Forward();
+    }
+    return;
+  }
+
+  unique_ptr<FairMQPoller> poller(fTransportFactory->CreatePoller(fChannels["data-in"]));
+
   while (CheckCurrentState(RUNNING)) {
-    // int i = 0;
-    int64_t more = 0;
-    size_t more_size = sizeof more;
-    do {
-      /* Create an empty ØMQ message to hold the message part */
-      FairMQMessage* msgpart = fTransportFactory->CreateMessage();
-      /* Block until a message is available to be received from socket */
-      fChannels["data-in"].at(0).Receive(msgpart);
-      /* Determine if more message parts are to follow */
-      fChannels["data-in"].at(0).fSocket->GetOption("rcv-more", &more, &more_size);
-      // LOG(INFO) << "------ Get Msg Part "<< " more = " << more << " counter " << i++ ;
-      if (more) {
-          fChannels["data-out"].at(0).Send(msgpart, "snd-more");
-      } else {
-          fChannels["data-out"].at(0).Send(msgpart);
+    poller->Poll(100);
+    if (!poller->CheckInput(0)) {
+      continue;
+    }
+
+    size_t numParts = 0;
+    ReceiveMessage(numParts);
+
+    // the latency budget starts with the first message, the messages are sent when they are complete or the budget is used up.
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(fAggregationLatencyInMs);
+    int numMessages = 1;
+
+    while (numMessages < fAggregateMessages) {
+      int remaining = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+      if (remaining <= 0) {
+        break;
+      }
+      poller->Poll(remaining);
+      if (poller->CheckInput(0)) {
+        ReceiveMessage(numParts);
+        ++numMessages;
       }
-      delete msgpart;
-    } while (more);
-    // i = 0;
+    }
+
+    Forward();
+  }
+}
+
+void O2Proxy::SetProperty(const int key, const string& value)
+{
+  switch (key) {
+  default:
+    FairMQDevice::SetProperty(key, value);
+    break;
+  }
+}
+
+string O2Proxy::GetProperty(const int key, const string& default_/*= ""*/)
+{
+  switch (key) {
+  default:
+    return FairMQDevice::GetProperty(key, default_);
+  }
+}
+
+void O2Proxy::SetProperty(const int key, const int value)
+{
+  switch (key) {
+  case AggregateMessages:
+    fAggregateMessages = value;
+    break;
+  case AggregationLatencyInMs:
+    fAggregationLatencyInMs = value;
+    break;
+  default:
+    FairMQDevice::SetProperty(key, value);
+    break;
+  }
+}
+
+int O2Proxy::GetProperty(const int key, const int default_/*= 0*/)
+{
+  switch (key) {
+  case AggregateMessages:
+    return fAggregateMessages;
+  case AggregationLatencyInMs:
+    return fAggregationLatencyInMs;
+  default:
+    return FairMQDevice::GetProperty(key, default_);
   }
 }
@@ -8,16 +8,48 @@
 #ifndef O2Proxy_H_
 #define O2Proxy_H_
 
+#include <string>
+#include <vector>
+
 #include "FairMQDevice.h"
 
+/// Forwards (multipart) messages from data-in to data-out
+///
+/// The parts of a message are received into message objects that are reused for every message, and forwarded
+/// back-to-back. With AggregateMessages > 1 up to that many input messages, arriving within
+/// AggregationLatencyInMs of the first one, are collected and sent in one burst. Every message keeps its own
+/// framing (last part without "snd-more"), so aggregation does not change what downstream receives.
 
 class O2Proxy: public FairMQDevice
 {
   public:
+    enum {
+      AggregateMessages = FairMQDevice::Last,
+      AggregationLatencyInMs,
+      Last
+    };
+
     O2Proxy();
     virtual ~O2Proxy();
+
+    virtual void SetProperty(const int key, const std::string& value);
+    virtual std::string GetProperty(const int key, const std::string& default_ = "");
+    virtual void SetProperty(const int key, const int value);
+    virtual int GetProperty(const int key, const int default_ = 0);
+
   protected:
+    int fAggregateMessages; ///< Maximum number of input messages per output message (1 - no aggregation)
+    int fAggregationLatencyInMs; ///< Maximum time to hold the first message of an aggregate
+    std::vector<FairMQMessage*> fParts; ///< Message objects, reused for every message
+    std::vector<size_t> fMessageEnds; ///< End of each collected message in fParts
+
     virtual void Run();
+
+    /// Receives all parts of one message, appending them to fParts and its end to fMessageEnds
+    /// @param numParts Number of parts already used, updated
+    void ReceiveMessage(size_t& numParts);
+    /// Sends the collected messages back-to-back, each as its own multipart message
+    void Forward();
 };
 
 #endif /* O2Proxy_H_ */
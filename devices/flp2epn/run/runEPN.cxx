@@ -28,6 +28,11 @@ typedef struct DeviceOptions
     int inputBufSize;
     string inputMethod;
     string inputAddress;
+    string processingMode;
+    string nsPerByte;
+    int reductionPasses;
+    int numWorkers;
+    int workQueueSize;
 } DeviceOptions_t;
 
 inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
@@ -44,6 +49,11 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
         ("input-buff-size", bpo::value<int>()->required(), "Input buffer size in number of messages (ZeroMQ)/bytes(nanomsg)")
         ("input-method", bpo::value<string>()->required(), "Input method: bind/connect")
         ("input-address", bpo::value<string>()->required(), "Input address, e.g.: \"tcp://localhost:5555\"")
+        ("processing-mode", bpo::value<string>()->default_value("none"), "Processing emulation: none/reduce/busy")
+        ("ns-per-byte", bpo::value<string>()->default_value("1"), "Busy time in nanoseconds per byte of data, may be fractional, e.g. 0.25 (busy mode)")
+        ("reduction-passes", bpo::value<int>()->default_value(1), "Number of passes over the data (reduce mode)")
+        ("num-workers", bpo::value<int>()->default_value(0), "Number of processing threads (0 - process in the receiving thread)")
+        ("work-queue-size", bpo::value<int>()->default_value(100), "Maximum number of messages waiting for the processing threads")
         ("help", "Print help messages");
 
     bpo::variables_map vm;
@@ -75,6 +85,21 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
     if ( vm.count("input-address") )
         _options->inputAddress = vm["input-address"].as<string>();
 
+    if ( vm.count("processing-mode") )
+        _options->processingMode = vm["processing-mode"].as<string>();
+
+    if ( vm.count("ns-per-byte") )
+        _options->nsPerByte = vm["ns-per-byte"].as<string>();
+
+    if ( vm.count("reduction-passes") )
+        _options->reductionPasses = vm["reduction-passes"].as<int>();
+
+    if ( vm.count("num-workers") )
+        _options->numWorkers = vm["num-workers"].as<int>();
+
+    if ( vm.count("work-queue-size") )
+        _options->workQueueSize = vm["work-queue-size"].as<int>();
+
     return true;
 }
 
@@ -107,6 +132,11 @@ int main(int argc, char** argv)
 
     epn.SetProperty(O2EPNex::Id, options.id);
     epn.SetProperty(O2EPNex::NumIoThreads, options.ioThreads);
+    epn.SetProperty(O2EPNex::ProcessingMode, options.processingMode);
+    epn.SetProperty(O2EPNex::NsPerByte, options.nsPerByte);
+    epn.SetProperty(O2EPNex::ReductionPasses, options.reductionPasses);
+    epn.SetProperty(O2EPNex::NumWorkers, options.numWorkers);
+    epn.SetProperty(O2EPNex::WorkQueueSize, options.workQueueSize);
 
     FairMQChannel inputChannel(options.inputSocketType, options.inputMethod, options.inputAddress);
     inputChannel.UpdateSndBufSize(options.inputBufSize);
@@ -24,6 +24,8 @@ typedef struct DeviceOptions
 {
     string id;
     int eventSize;
+    string sizeDistribution;
+    int payloadPoolSize;
     int ioThreads;
     string outputSocketType;
     int outputBufSize;
@@ -40,7 +42,9 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
     bpo::options_description desc("Options");
     desc.add_options()
         ("id", bpo::value<string>()->required(), "Device ID")
-        ("event-size", bpo::value<int>()->default_value(1000), "Event size in bytes")
+        ("event-size", bpo::value<int>()->default_value(1000), "Event size in number of records")
+        ("size-distribution", bpo::value<string>()->default_value("fixed"), "Distribution of the event size: fixed/uniform/exponential (mean event-size)")
+        ("payload-pool-size", bpo::value<int>()->default_value(0), "Number of pre-generated payloads sent round-robin (0 - generate every event)")
         ("io-threads", bpo::value<int>()->default_value(1), "Number of I/O threads")
         ("output-socket-type", bpo::value<string>()->required(), "Output socket type: pub/push")
         ("output-buff-size", bpo::value<int>()->required(), "Output buffer size in number of messages (ZeroMQ)/bytes(nanomsg)")
@@ -65,6 +69,12 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
     if ( vm.count("event-size") )
         _options->eventSize = vm["event-size"].as<int>();
 
+    if ( vm.count("size-distribution") )
+        _options->sizeDistribution = vm["size-distribution"].as<string>();
+
+    if ( vm.count("payload-pool-size") )
+        _options->payloadPoolSize = vm["payload-pool-size"].as<int>();
+
     if ( vm.count("io-threads") )
         _options->ioThreads = vm["io-threads"].as<int>();
 
@@ -113,6 +123,8 @@ int main(int argc, char** argv)
     flp.SetProperty(O2FLPex::Id, options.id);
     flp.SetProperty(O2FLPex::NumIoThreads, options.ioThreads);
     flp.SetProperty(O2FLPex::EventSize, options.eventSize);
+    flp.SetProperty(O2FLPex::SizeDistribution, options.sizeDistribution);
+    flp.SetProperty(O2FLPex::PayloadPoolSize, options.payloadPoolSize);
 
     FairMQChannel outputChannel(options.outputSocketType, options.outputMethod, options.outputAddress);
     outputChannel.UpdateSndBufSize(options.outputBufSize);
@@ -25,6 +25,7 @@ typedef struct DeviceOptions
     string id;
     int ioThreads;
     int numInputs;
+    int mergeWindow;
     vector<string> inputSocketType;
     vector<int> inputBufSize;
     vector<string> inputMethod;
@@ -46,6 +47,7 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
         ("id", bpo::value<string>()->required(), "Device ID")
         ("io-threads", bpo::value<int>()->default_value(1), "Number of I/O threads")
         ("num-inputs", bpo::value<int>()->required(), "Number of input sockets")
+        ("merge-window", bpo::value<int>()->default_value(0), "Time in ms to wait for the remaining inputs after the first message of a batch (0 - wait for all inputs)")
         ("input-socket-type", bpo::value< vector<string> >()->required(), "Input socket type: sub/pull")
         ("input-buff-size", bpo::value< vector<int> >()->required(), "Input buffer size in number of messages (ZeroMQ)/bytes(nanomsg)")
         ("input-method", bpo::value< vector<string> >()->required(), "Input method: bind/connect")
@@ -76,6 +78,9 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
     if ( vm.count("num-inputs") )
         _options->numInputs = vm["num-inputs"].as<int>();
 
+    if ( vm.count("merge-window") )
+        _options->mergeWindow = vm["merge-window"].as<int>();
+
     if ( vm.count("input-socket-type") )
         _options->inputSocketType = vm["input-socket-type"].as< vector<string> >();
 
@@ -132,6 +137,7 @@ int main(int argc, char** argv)
 
     merger.SetProperty(O2Merger::Id, options.id);
     merger.SetProperty(O2Merger::NumIoThreads, options.ioThreads);
+    merger.SetProperty(O2Merger::MergeWindowInMs, options.mergeWindow);
 
     for (int i = 0; i < options.inputAddress.size(); ++i)
     {
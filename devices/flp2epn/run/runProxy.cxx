@@ -24,6 +24,8 @@ typedef struct DeviceOptions
 {
     string id;
     int ioThreads;
+    int aggregateMessages;
+    int aggregationLatency;
     string inputSocketType;
     int inputBufSize;
     string inputMethod;
@@ -44,6 +46,8 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
     desc.add_options()
         ("id", bpo::value<string>()->required(), "Device ID")
         ("io-threads", bpo::value<int>()->default_value(1), "Number of I/O threads")
+        ("aggregate-messages", bpo::value<int>()->default_value(1), "Maximum number of input messages sent together in one burst, each keeping its own framing (1 - no aggregation)")
+        ("aggregation-latency", bpo::value<int>()->default_value(1), "Maximum time in ms to hold a message for aggregation")
         ("input-socket-type", bpo::value<string>()->required(), "Input socket type: sub/pull")
         ("input-buff-size", bpo::value<int>()->required(), "Input buffer size in number of messages (ZeroMQ)/bytes(nanomsg)")
         ("input-method", bpo::value<string>()->required(), "Input method: bind/connect")
@@ -71,6 +75,12 @@ inline bool parse_cmd_line(int _argc, char* _argv[], DeviceOptions* _options)
     if ( vm.count("io-threads") )
         _options->ioThreads = vm["io-threads"].as<int>();
 
+    if ( vm.count("aggregate-messages") )
+        _options->aggregateMessages = vm["aggregate-messages"].as<int>();
+
+    if ( vm.count("aggregation-latency") )
+        _options->aggregationLatency = vm["aggregation-latency"].as<int>();
+
     if ( vm.count("input-socket-type") )
         _options->inputSocketType = vm["input-socket-type"].as<string>();
 
@@ -127,6 +137,8 @@ int main(int argc, char** argv)
 
     proxy.SetProperty(O2Proxy::Id, options.id);
     proxy.SetProperty(O2Proxy::NumIoThreads, options.ioThreads);
+    proxy.SetProperty(O2Proxy::AggregateMessages, options.aggregateMessages);
+    proxy.SetProperty(O2Proxy::AggregationLatencyInMs, options.aggregationLatency);
 
     FairMQChannel inputChannel(options.inputSocketType, options.inputMethod, options.inputAddress);
     inputChannel.UpdateSndBufSize(options.inputBufSize);